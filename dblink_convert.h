@@ -0,0 +1,510 @@
+// ODBC result set buffer conversion kernels used by DBLINK().
+//
+// This header depends only on the ODBC headers, so the conversions can be built and
+// benchmarked without the Vertica SDK (see microbench.cpp and "make microbench").
+// Values are written through a Writer with the following members:
+//
+//   void setNull(size_t col);
+//   void setInt(size_t col, int64_t v);
+//   void setFloat(size_t col, double v);
+//   bool setNumeric(size_t col, char *text, size_t len); // false if the text cannot be parsed
+//   void setString(size_t col, const char *s, size_t len);
+//   void setBool(size_t col, bool v);
+//   void setDate(size_t col, int64_t days);            // days since 2000-01-01
+//   void setTime(size_t col, int64_t us);              // microseconds since midnight
+//   void setTimestamp(size_t col, int64_t us);         // microseconds since 2000-01-01 00:00:00
+//   void setInterval(size_t col, int64_t v);           // months (YEAR TO MONTH) or microseconds
+
+#ifndef DBLINK_CONVERT_H
+#define DBLINK_CONVERT_H
+
+#include <sql.h>
+#include <sqlext.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace DBLINK
+{
+    // Conversion results, same values as the DBLINK error codes they are reported with
+    enum ConvertStatus
+    {
+        CONVERT_OK = 0,
+        CONVERT_NUMERIC = 404,     // NUMERIC text not parsed
+        CONVERT_INTERVAL_YM = 405, // not a SQL_IS_YEAR_TO_MONTH interval
+        CONVERT_INTERVAL_DS = 406, // not a SQL_IS_DAY_TO_SECOND interval
+        CONVERT_UNSUPPORTED = 407  // unsupported ODBC data type
+    };
+
+    const int64_t CONVERT_US_PER_SECOND = 1000000LL;
+    const int64_t CONVERT_US_PER_MINUTE = 60 * CONVERT_US_PER_SECOND;
+    const int64_t CONVERT_US_PER_HOUR = 60 * CONVERT_US_PER_MINUTE;
+    const int64_t CONVERT_US_PER_DAY = 24 * CONVERT_US_PER_HOUR;
+
+    // Days between 2000-01-01 and the given proleptic Gregorian date
+    inline int64_t daysSince2000(int64_t y, unsigned m, unsigned d)
+    {
+        y -= (m <= 2);
+        const int64_t era = (y >= 0 ? y : y - 399) / 400;
+        const unsigned yoe = (unsigned)(y - era * 400);
+        const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+        const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + (int64_t)doe - 730425; // 730425: days from 0000-03-01 to 2000-01-01
+    }
+
+    inline int64_t convertDate(const SQL_DATE_STRUCT &sd)
+    {
+        return daysSince2000(sd.year, sd.month, sd.day);
+    }
+
+    inline int64_t convertTime(const SQL_TIME_STRUCT &st)
+    {
+        return (st.hour * 3600 + st.minute * 60 + st.second) * CONVERT_US_PER_SECOND;
+    }
+
+    inline int64_t convertTimestamp(const SQL_TIMESTAMP_STRUCT &ss)
+    {
+        return daysSince2000(ss.year, ss.month, ss.day) * CONVERT_US_PER_DAY +
+               ss.hour * CONVERT_US_PER_HOUR + ss.minute * CONVERT_US_PER_MINUTE + ss.second * CONVERT_US_PER_SECOND +
+               ss.fraction / 1000;
+    }
+
+    inline int64_t convertIntervalYM(const SQL_INTERVAL_STRUCT &intv)
+    {
+        return ((int64_t)intv.intval.year_month.year * 12 + intv.intval.year_month.month) * (intv.interval_sign == SQL_TRUE ? -1 : 1);
+    }
+
+    inline int64_t convertIntervalDS(const SQL_INTERVAL_STRUCT &intv)
+    {
+        return ((int64_t)intv.intval.day_second.day * CONVERT_US_PER_DAY + (int64_t)intv.intval.day_second.hour * CONVERT_US_PER_HOUR +
+                (int64_t)intv.intval.day_second.minute * CONVERT_US_PER_MINUTE + (int64_t)intv.intval.day_second.second * CONVERT_US_PER_SECOND +
+                intv.intval.day_second.fraction / 1000) *
+               (intv.interval_sign == SQL_TRUE ? -1 : 1);
+    }
+
+    // Proleptic Gregorian date of the given number of days since 2000-01-01
+    inline void civilFromDays2000(int64_t days, int64_t &y, unsigned &m, unsigned &d)
+    {
+        const int64_t z = days + 730425;
+        const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+        const unsigned doe = (unsigned)(z - era * 146097);
+        const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        const unsigned mp = (5 * doy + 2) / 153;
+        d = doy - (153 * mp + 2) / 5 + 1;
+        m = mp < 10 ? mp + 3 : mp - 9;
+        y = (int64_t)yoe + era * 400 + (m <= 2);
+    }
+
+    // Inverse conversions, used to bind values pushed to the remote database
+    inline void toDateStruct(int64_t days, SQL_DATE_STRUCT &sd)
+    {
+        int64_t y;
+        unsigned m, d;
+        civilFromDays2000(days, y, m, d);
+        sd.year = (SQLSMALLINT)y;
+        sd.month = (SQLUSMALLINT)m;
+        sd.day = (SQLUSMALLINT)d;
+    }
+
+    inline void toTimeStruct(int64_t us, SQL_TIME_STRUCT &st)
+    {
+        int64_t s = us / CONVERT_US_PER_SECOND;
+        st.hour = (SQLUSMALLINT)(s / 3600);
+        st.minute = (SQLUSMALLINT)(s / 60 % 60);
+        st.second = (SQLUSMALLINT)(s % 60);
+    }
+
+    inline void toTimestampStruct(int64_t us, SQL_TIMESTAMP_STRUCT &ss)
+    {
+        int64_t days = us / CONVERT_US_PER_DAY;
+        int64_t rem = us % CONVERT_US_PER_DAY;
+        int64_t y;
+        unsigned m, d;
+        if (rem < 0)
+        {
+            days--;
+            rem += CONVERT_US_PER_DAY;
+        }
+        civilFromDays2000(days, y, m, d);
+        ss.year = (SQLSMALLINT)y;
+        ss.month = (SQLUSMALLINT)m;
+        ss.day = (SQLUSMALLINT)d;
+        ss.hour = (SQLUSMALLINT)(rem / CONVERT_US_PER_HOUR);
+        ss.minute = (SQLUSMALLINT)(rem / CONVERT_US_PER_MINUTE % 60);
+        ss.second = (SQLUSMALLINT)(rem / CONVERT_US_PER_SECOND % 60);
+        ss.fraction = (SQLUINTEGER)(rem % CONVERT_US_PER_SECOND * 1000);
+    }
+
+    inline void toIntervalYM(int64_t months, SQL_INTERVAL_STRUCT &intv)
+    {
+        uint64_t m = (uint64_t)(months < 0 ? -months : months);
+        memset(&intv, 0, sizeof(intv));
+        intv.interval_type = SQL_IS_YEAR_TO_MONTH;
+        intv.interval_sign = (months < 0) ? SQL_TRUE : SQL_FALSE;
+        intv.intval.year_month.year = (SQLUINTEGER)(m / 12);
+        intv.intval.year_month.month = (SQLUINTEGER)(m % 12);
+    }
+
+    inline void toIntervalDS(int64_t us, SQL_INTERVAL_STRUCT &intv)
+    {
+        uint64_t u = (uint64_t)(us < 0 ? -us : us);
+        memset(&intv, 0, sizeof(intv));
+        intv.interval_type = SQL_IS_DAY_TO_SECOND;
+        intv.interval_sign = (us < 0) ? SQL_TRUE : SQL_FALSE;
+        intv.intval.day_second.day = (SQLUINTEGER)(u / CONVERT_US_PER_DAY);
+        intv.intval.day_second.hour = (SQLUINTEGER)(u / CONVERT_US_PER_HOUR % 24);
+        intv.intval.day_second.minute = (SQLUINTEGER)(u / CONVERT_US_PER_MINUTE % 60);
+        intv.intval.day_second.second = (SQLUINTEGER)(u / CONVERT_US_PER_SECOND % 60);
+        intv.intval.day_second.fraction = (SQLUINTEGER)(u % CONVERT_US_PER_SECOND * 1000);
+    }
+
+    // Converts the value bound at Odp (length/indicator Odl) of a column of ODBC type Odt and writes it
+    // to column j. textInt is set when integers are bound as text (Oracle), desz is the bound element size
+    template <class Writer>
+    inline ConvertStatus convertValue(Writer &w, size_t j, SQLSMALLINT Odt, bool textInt, SQLPOINTER Odp, SQLLEN Odl, size_t desz)
+    {
+        if (Odl == SQL_NULL_DATA)
+        {
+            w.setNull(j);
+            return CONVERT_OK;
+        }
+
+        switch (Odt)
+        {
+        case SQL_SMALLINT:
+        case SQL_INTEGER:
+        case SQL_TINYINT:
+        case SQL_BIGINT:
+            if (!textInt)
+            {
+                w.setInt(j, *(SQLBIGINT *)Odp);
+            }
+            else if (Odl == SQL_NTS)
+            {
+                w.setNull(j);
+            }
+            else
+            {
+                w.setInt(j, (int64_t)atoll((char *)Odp));
+            }
+            return CONVERT_OK;
+        case SQL_REAL:
+        case SQL_DOUBLE:
+        case SQL_FLOAT:
+            w.setFloat(j, *(SQLDOUBLE *)Odp);
+            return CONVERT_OK;
+        case SQL_NUMERIC:
+        case SQL_DECIMAL:
+            if (*(char *)Odp == '\0')
+            { // some DBs might use empty strings for NUMERIC nulls
+                w.setNull(j);
+                return CONVERT_OK;
+            }
+            return w.setNumeric(j, (char *)Odp, (size_t)Odl) ? CONVERT_OK : CONVERT_NUMERIC;
+        case SQL_CHAR:
+        case SQL_WCHAR:
+        case SQL_VARCHAR:
+        case SQL_WVARCHAR:
+        case SQL_LONGVARCHAR:
+        case SQL_WLONGVARCHAR:
+        case SQL_BINARY:
+        case SQL_VARBINARY:
+        case SQL_LONGVARBINARY:
+            if (Odl == SQL_NTS)
+            {
+                Odl = (SQLLEN)strnlen((char *)Odp, desz);
+            }
+            else if ((size_t)Odl >= desz)
+            { // truncated to the bound buffer
+                Odl = (SQLLEN)(desz - 1);
+            }
+            w.setString(j, (const char *)Odp, (size_t)Odl);
+            return CONVERT_OK;
+        case SQL_TYPE_TIME:
+            w.setTime(j, convertTime(*(SQL_TIME_STRUCT *)Odp));
+            return CONVERT_OK;
+        case SQL_TYPE_DATE:
+            w.setDate(j, convertDate(*(SQL_DATE_STRUCT *)Odp));
+            return CONVERT_OK;
+        case SQL_TYPE_TIMESTAMP:
+            w.setTimestamp(j, convertTimestamp(*(SQL_TIMESTAMP_STRUCT *)Odp));
+            return CONVERT_OK;
+        case SQL_BIT:
+            w.setBool(j, *(SQLCHAR *)Odp == SQL_TRUE);
+            return CONVERT_OK;
+        case SQL_INTERVAL_YEAR_TO_MONTH: // Vertica stores these Intervals as durations in months
+            if (((SQL_INTERVAL_STRUCT *)Odp)->interval_type != SQL_IS_YEAR_TO_MONTH)
+            {
+                return CONVERT_INTERVAL_YM;
+            }
+            w.setInterval(j, convertIntervalYM(*(SQL_INTERVAL_STRUCT *)Odp));
+            return CONVERT_OK;
+        case SQL_INTERVAL_DAY_TO_SECOND: // Vertica stores these Intervals as durations in microseconds
+            if (((SQL_INTERVAL_STRUCT *)Odp)->interval_type != SQL_IS_DAY_TO_SECOND)
+            {
+                return CONVERT_INTERVAL_DS;
+            }
+            w.setInterval(j, convertIntervalDS(*(SQL_INTERVAL_STRUCT *)Odp));
+            return CONVERT_OK;
+        default:
+            return CONVERT_UNSUPPORTED;
+        }
+    }
+
+    // Converted value of a rowset cell, waiting to be written by the thread owning the Writer
+    enum StagedKinds
+    {
+        STAGED_NULL = 0,
+        STAGED_INT,
+        STAGED_FLOAT,
+        STAGED_NUMERIC, // text, parsed when written
+        STAGED_STRING,
+        STAGED_BOOL,
+        STAGED_DATE,
+        STAGED_TIME,
+        STAGED_TIMESTAMP,
+        STAGED_INTERVAL
+    };
+
+    struct StagedValue
+    {
+        StagedKinds kind;
+        size_t len;
+        union
+        {
+            int64_t i;
+            double f;
+            const char *s; // points into the bound rowset buffer
+        };
+    };
+
+    // Writer staging the values of one column, element row of col
+    class StagingWriter
+    {
+        StagedValue *col;
+
+    public:
+        size_t row = 0;
+
+        explicit StagingWriter(StagedValue *c) : col(c) {}
+
+        inline void setNull(size_t j)
+        {
+            col[row].kind = STAGED_NULL;
+        }
+        inline void setInt(size_t j, int64_t v)
+        {
+            col[row].kind = STAGED_INT;
+            col[row].i = v;
+        }
+        inline void setFloat(size_t j, double v)
+        {
+            col[row].kind = STAGED_FLOAT;
+            col[row].f = v;
+        }
+        inline bool setNumeric(size_t j, char *text, size_t len)
+        {
+            col[row].kind = STAGED_NUMERIC;
+            col[row].s = text;
+            col[row].len = len;
+            return true;
+        }
+        inline void setString(size_t j, const char *s, size_t len)
+        {
+            col[row].kind = STAGED_STRING;
+            col[row].s = s;
+            col[row].len = len;
+        }
+        inline void setBool(size_t j, bool v)
+        {
+            col[row].kind = STAGED_BOOL;
+            col[row].i = v;
+        }
+        inline void setDate(size_t j, int64_t days)
+        {
+            col[row].kind = STAGED_DATE;
+            col[row].i = days;
+        }
+        inline void setTime(size_t j, int64_t us)
+        {
+            col[row].kind = STAGED_TIME;
+            col[row].i = us;
+        }
+        inline void setTimestamp(size_t j, int64_t us)
+        {
+            col[row].kind = STAGED_TIMESTAMP;
+            col[row].i = us;
+        }
+        inline void setInterval(size_t j, int64_t v)
+        {
+            col[row].kind = STAGED_INTERVAL;
+            col[row].i = v;
+        }
+    };
+
+    // Converts nrows rows of one bound column into col. errrow is the row of a failed conversion
+    inline ConvertStatus stageColumn(StagedValue *col, SQLSMALLINT Odt, bool textInt, SQLPOINTER Ores, SQLLEN *Olen,
+                                     size_t desz, size_t nrows, size_t &errrow)
+    {
+        StagingWriter w(col);
+        for (w.row = 0; w.row < nrows; w.row++)
+        {
+            ConvertStatus rc = convertValue(w, 0, Odt, textInt, (SQLPOINTER)((uint8_t *)Ores + desz * w.row), Olen[w.row], desz);
+            if (rc != CONVERT_OK)
+            {
+                errrow = w.row;
+                return rc;
+            }
+        }
+        return CONVERT_OK;
+    }
+
+    // Writes a staged value to column j. Returns false if a NUMERIC text cannot be parsed
+    template <class Writer>
+    inline bool writeStaged(Writer &w, size_t j, const StagedValue &v)
+    {
+        switch (v.kind)
+        {
+        case STAGED_INT:
+            w.setInt(j, v.i);
+            return true;
+        case STAGED_FLOAT:
+            w.setFloat(j, v.f);
+            return true;
+        case STAGED_NUMERIC:
+            return w.setNumeric(j, (char *)v.s, v.len);
+        case STAGED_STRING:
+            w.setString(j, v.s, v.len);
+            return true;
+        case STAGED_BOOL:
+            w.setBool(j, v.i != 0);
+            return true;
+        case STAGED_DATE:
+            w.setDate(j, v.i);
+            return true;
+        case STAGED_TIME:
+            w.setTime(j, v.i);
+            return true;
+        case STAGED_TIMESTAMP:
+            w.setTimestamp(j, v.i);
+            return true;
+        case STAGED_INTERVAL:
+            w.setInterval(j, v.i);
+            return true;
+        default:
+            w.setNull(j);
+            return true;
+        }
+    }
+
+    // Small pool of threads running the tasks of a job (one per column). run() returns once every
+    // task is done, the calling thread takes tasks too. Tasks must not call the Vertica SDK
+    class ConvertPool
+    {
+        std::vector<std::thread> threads;
+        std::mutex mtx;
+        std::condition_variable start;
+        std::condition_variable done;
+        std::function<void(size_t)> task;
+        std::atomic<size_t> next{0};
+        size_t ntasks = 0;
+        size_t busy = 0;
+        uint64_t job = 0;
+        bool stop = false;
+
+        void work()
+        {
+            size_t t;
+            while ((t = next.fetch_add(1)) < ntasks)
+            {
+                task(t);
+            }
+        }
+
+        void loop()
+        {
+            uint64_t seen = 0;
+            std::unique_lock<std::mutex> lk(mtx);
+            for (;;)
+            {
+                start.wait(lk, [&]() { return stop || job != seen; });
+                if (stop)
+                {
+                    return;
+                }
+                seen = job;
+                busy++;
+                lk.unlock();
+                work();
+                lk.lock();
+                if (--busy == 0)
+                {
+                    done.notify_one();
+                }
+            }
+        }
+
+    public:
+        explicit ConvertPool(size_t nthreads)
+        {
+            for (size_t k = 1; k < nthreads; k++)
+            {
+                threads.emplace_back(&ConvertPool::loop, this);
+            }
+        }
+
+        ~ConvertPool()
+        {
+            {
+                std::lock_guard<std::mutex> lk(mtx);
+                stop = true;
+            }
+            start.notify_all();
+            for (auto &t : threads)
+            {
+                t.join();
+            }
+        }
+
+        void run(size_t n, const std::function<void(size_t)> &f)
+        {
+            {
+                std::lock_guard<std::mutex> lk(mtx);
+                task = f;
+                ntasks = n;
+                next = 0;
+                job++;
+            }
+            start.notify_all();
+            work();
+            std::unique_lock<std::mutex> lk(mtx);
+            done.wait(lk, [&]() { return busy == 0; });
+        }
+    };
+
+    // Converts row i of a rowset bound by column (Ores[j] holds rowset elements of desz[j] bytes)
+    template <class Writer>
+    inline ConvertStatus convertRow(Writer &w, size_t ncol, const SQLSMALLINT *Odt, bool textInt,
+                                    SQLPOINTER *Ores, SQLLEN **Olen, const size_t *desz, size_t i, size_t &errcol)
+    {
+        for (size_t j = 0; j < ncol; j++)
+        {
+            ConvertStatus rc = convertValue(w, j, Odt[j], textInt, (SQLPOINTER)((uint8_t *)Ores[j] + desz[j] * i), Olen[j][i], desz[j]);
+            if (rc != CONVERT_OK)
+            {
+                errcol = j;
+                return rc;
+            }
+        }
+        return CONVERT_OK;
+    }
+}
+
+#endif
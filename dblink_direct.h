@@ -0,0 +1,148 @@
+// Direct fetch from the ODBC driver library, used by DBLINK() with direct_fetch=true.
+//
+// The driver manager connects, prepares, binds and executes as usual. The fetch loop then calls
+// SQLFetchScroll of the driver library itself with the driver's statement handle (SQL_DRIVER_HSTMT),
+// skipping the handle validation, locking and state tracking of the driver manager on every rowset.
+// This header depends only on the ODBC headers and libdl (see fetchbench.cpp and "make fetchbench").
+
+#ifndef DBLINK_DIRECT_H
+#define DBLINK_DIRECT_H
+
+#include <sql.h>
+#include <sqlext.h>
+#include <dlfcn.h>
+#include <link.h>
+#include <cstring>
+#include <string>
+
+namespace DBLINK
+{
+    class DirectFetch
+    {
+        typedef SQLRETURN (*FetchScrollFn)(SQLHSTMT, SQLSMALLINT, SQLLEN);
+        typedef SQLRETURN (*GetDiagRecFn)(SQLSMALLINT, SQLHANDLE, SQLSMALLINT, SQLCHAR *, SQLINTEGER *, SQLCHAR *, SQLSMALLINT, SQLSMALLINT *);
+
+        void *lib = nullptr;
+        SQLHSTMT Odst = nullptr; // driver statement handle
+        FetchScrollFn fetchScroll = nullptr;
+        GetDiagRecFn getDiagRec = nullptr;
+
+        struct Loaded
+        {
+            const char *name;
+            std::string path;
+        };
+
+        static int findLoaded(struct dl_phdr_info *info, size_t size, void *data)
+        {
+            Loaded *l = (Loaded *)data;
+            const char *base = strrchr(info->dlpi_name, '/');
+            base = base ? base + 1 : info->dlpi_name;
+            if (info->dlpi_name[0] && !strcmp(base, l->name))
+            {
+                l->path = info->dlpi_name;
+                return 1;
+            }
+            return 0;
+        }
+
+        // True if the symbol is defined by the driver library, not by a driver manager it is linked with
+        bool definedByDriver(void *sym, const std::string &path)
+        {
+            Dl_info info;
+            return sym && dladdr(sym, &info) && info.dli_fname && path == info.dli_fname;
+        }
+
+    public:
+        ~DirectFetch()
+        {
+            close();
+        }
+
+        // Resolves the driver of the connection among the libraries loaded by the driver manager, and the
+        // driver handle of Ost. False, with the reason in why, when the driver cannot be called directly
+        bool open(SQLHDBC Ocon, SQLHSTMT Ost, std::string &why)
+        {
+            SQLCHAR Oname[256];
+            Loaded l;
+
+            close();
+            if (!SQL_SUCCEEDED(SQLGetInfo(Ocon, SQL_DRIVER_NAME, (SQLPOINTER)Oname, (SQLSMALLINT)sizeof(Oname), NULL)))
+            {
+                why = "driver name not reported";
+                return false;
+            }
+            l.name = strrchr((char *)Oname, '/') ? strrchr((char *)Oname, '/') + 1 : (char *)Oname;
+            dl_iterate_phdr(findLoaded, &l);
+            if (l.path.empty())
+            {
+                why = std::string("driver ") + l.name + " not found among the loaded libraries";
+                return false;
+            }
+            if (!(lib = dlopen(l.path.c_str(), RTLD_NOW | RTLD_NOLOAD)))
+            {
+                why = dlerror();
+                return false;
+            }
+            fetchScroll = (FetchScrollFn)dlsym(lib, "SQLFetchScroll");
+            getDiagRec = (GetDiagRecFn)dlsym(lib, "SQLGetDiagRec");
+            if (!definedByDriver((void *)fetchScroll, l.path))
+            {
+                why = "SQLFetchScroll not exported by " + l.path;
+                close();
+                return false;
+            }
+            if (!definedByDriver((void *)getDiagRec, l.path))
+            {
+                getDiagRec = nullptr;
+            }
+            Odst = Ost;
+            if (!SQL_SUCCEEDED(SQLGetInfo(Ocon, SQL_DRIVER_HSTMT, (SQLPOINTER)&Odst, (SQLSMALLINT)sizeof(Odst), NULL)) || !Odst || Odst == Ost)
+            {
+                why = "driver statement handle not reported";
+                close();
+                return false;
+            }
+            return true;
+        }
+
+        bool active() const
+        {
+            return fetchScroll != nullptr;
+        }
+
+        SQLRETURN fetch()
+        {
+            return fetchScroll(Odst, SQL_FETCH_NEXT, 0);
+        }
+
+        // First diagnostic record of the driver statement: the driver manager did not see the direct calls
+        std::string diag()
+        {
+            SQLCHAR Oerr_state[6];
+            SQLINTEGER Oerr_native = 0;
+            SQLCHAR Oerr_text[1024];
+            SQLSMALLINT Oln = 0;
+
+            if (!getDiagRec || !SQL_SUCCEEDED(getDiagRec(SQL_HANDLE_STMT, Odst, 1, Oerr_state, &Oerr_native, Oerr_text, (SQLSMALLINT)sizeof(Oerr_text), &Oln)))
+            {
+                return "no diagnostic record";
+            }
+            return std::string("State ") + (char *)Oerr_state + ". Native Code " + std::to_string((int)Oerr_native) + ". Error text: " + (char *)Oerr_text;
+        }
+
+        void close()
+        {
+            if (lib)
+            {
+                dlclose(lib);
+            }
+            lib = nullptr;
+            Odst = nullptr;
+            fetchScroll = nullptr;
+            getDiagRec = nullptr;
+        }
+    };
+}
+
+#endif
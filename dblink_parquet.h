@@ -0,0 +1,847 @@
+// Parquet file writer used by DBLINK() with parquet_path.
+//
+// The rowsets bound by DBLINK are converted by the kernels of dblink_convert.h with ParquetWriter as
+// their Writer, column by column, into PLAIN encoded data pages (v1) of parquetPageBytes() at most.
+// Pages are GZIP compressed (zlib) as they fill up, row groups are written every PARQUET_ROW_GROUP_BYTES
+// and the footer when the file is closed. Every column is OPTIONAL. The columns of a rowset are
+// independent, so they can be appended on a ConvertPool. Depends only on the ODBC headers and zlib.
+
+#ifndef DBLINK_PARQUET_H
+#define DBLINK_PARQUET_H
+
+#include "dblink_convert.h"
+
+#include <zlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define PARQUET_PAGE_BYTES (1 << 20)       // Max encoded values per data page
+#define PARQUET_MIN_PAGE_BYTES (64 << 10)  // Min encoded values per data page
+#define PARQUET_OPEN_PAGES_BYTES (64 << 20) // Data pages being encoded, all the columns together
+#define PARQUET_PAGE_ROWS (1 << 20)        // Rows per data page, for the columns of NULLs
+#define PARQUET_ROW_GROUP_BYTES (64 << 20) // Compressed pages buffered per row group
+#define PARQUET_GZIP_LEVEL 1               // zlib level: extraction speed over ratio
+
+namespace DBLINK
+{
+    // Physical types, converted types and codecs of the Parquet format
+    enum ParquetTypes
+    {
+        PQ_BOOLEAN = 0,
+        PQ_INT32 = 1,
+        PQ_INT64 = 2,
+        PQ_DOUBLE = 5,
+        PQ_BYTE_ARRAY = 6,
+        PQ_FIXED_LEN_BYTE_ARRAY = 7
+    };
+
+    enum ParquetConverted
+    {
+        PQ_NONE = -1,
+        PQ_UTF8 = 0,
+        PQ_DECIMAL = 5,
+        PQ_DATE = 6,
+        PQ_TIME_MICROS = 8,
+        PQ_TIMESTAMP_MICROS = 10
+    };
+
+    enum ParquetCodecs
+    {
+        PQ_UNCOMPRESSED = 0,
+        PQ_GZIP = 2
+    };
+
+    const int64_t PARQUET_EPOCH_DAYS = 10957; // days from 1970-01-01 to 2000-01-01
+    const int PARQUET_DECIMAL_BYTES = 16;     // FIXED_LEN_BYTE_ARRAY decimals, up to 38 digits
+    const int MAX_DECIMAL_DIGITS = 160;       // significant digits of a decimal text
+
+    // Data page size of a file of ncol columns, so that their open pages fit PARQUET_OPEN_PAGES_BYTES
+    inline size_t parquetPageBytes(size_t ncol)
+    {
+        return std::max((size_t)PARQUET_MIN_PAGE_BYTES, std::min((size_t)PARQUET_PAGE_BYTES, (size_t)PARQUET_OPEN_PAGES_BYTES / std::max(ncol, (size_t)1)));
+    }
+
+    // Memory a ParquetWriter of ncol columns buffers at most: the compressed pages of a row group, the open page
+    // of each column, and the raw and compressed copies of the pages flushed at once by nthreads threads
+    inline size_t parquetMemory(size_t ncol, size_t nthreads)
+    {
+        return PARQUET_ROW_GROUP_BYTES + (ncol + 2 * std::max(nthreads, (size_t)1)) * parquetPageBytes(ncol);
+    }
+
+    struct ParquetColumn
+    {
+        std::string name;
+        ParquetTypes type = PQ_BYTE_ARRAY;
+        ParquetConverted converted = PQ_NONE;
+        int precision = 0;
+        int scale = 0;
+    };
+
+    // Parquet column of a result set column of ODBC type Odt, described with size Ors and decimal digits Odd.
+    // Intervals are written as INT64 months (YEAR TO MONTH) or microseconds, NUMERICs wider than 38 digits as text
+    inline ParquetColumn parquetColumn(const std::string &name, SQLSMALLINT Odt, SQLULEN Ors, SQLSMALLINT Odd)
+    {
+        ParquetColumn c;
+        c.name = name;
+        switch (Odt)
+        {
+        case SQL_SMALLINT:
+        case SQL_INTEGER:
+        case SQL_TINYINT:
+        case SQL_BIGINT:
+        case SQL_INTERVAL_YEAR_TO_MONTH:
+        case SQL_INTERVAL_DAY_TO_SECOND:
+            c.type = PQ_INT64;
+            break;
+        case SQL_REAL:
+        case SQL_DOUBLE:
+        case SQL_FLOAT:
+            c.type = PQ_DOUBLE;
+            break;
+        case SQL_NUMERIC:
+        case SQL_DECIMAL:
+            if (Ors == 0 || Ors > 38 || Odd < 0 || (SQLULEN)Odd > Ors)
+            { // unconstrained or too wide for a Parquet decimal
+                c.converted = PQ_UTF8;
+                break;
+            }
+            c.type = (Ors <= 18) ? PQ_INT64 : PQ_FIXED_LEN_BYTE_ARRAY;
+            c.converted = PQ_DECIMAL;
+            c.precision = (int)Ors;
+            c.scale = (int)Odd;
+            break;
+        case SQL_CHAR:
+        case SQL_WCHAR:
+        case SQL_VARCHAR:
+        case SQL_WVARCHAR:
+        case SQL_LONGVARCHAR:
+        case SQL_WLONGVARCHAR:
+            c.converted = PQ_UTF8;
+            break;
+        case SQL_TYPE_DATE:
+            c.type = PQ_INT32;
+            c.converted = PQ_DATE;
+            break;
+        case SQL_TYPE_TIME:
+            c.type = PQ_INT64;
+            c.converted = PQ_TIME_MICROS;
+            break;
+        case SQL_TYPE_TIMESTAMP:
+            c.type = PQ_INT64;
+            c.converted = PQ_TIMESTAMP_MICROS;
+            break;
+        case SQL_BIT:
+            c.type = PQ_BOOLEAN;
+            break;
+        default: // binary
+            break;
+        }
+        return c;
+    }
+
+    // Unscaled value of a decimal text ("-12.5", "1.25E+3") at the given scale, rounded half away from zero.
+    // False if the text cannot be parsed or does not fit in precision digits
+    inline bool parseDecimal(const char *text, size_t len, int precision, int scale, __int128 &v)
+    {
+        const char *p = text;
+        const char *end = text + strnlen(text, len);
+        char digits[MAX_DECIMAL_DIGITS];
+        int ndig = 0;
+        int frac = 0; // digits after the point
+        bool point = false;
+        bool neg = false;
+        bool any = false;
+        __int128 limit = 1;
+
+        while (p < end && *p == ' ')
+        {
+            p++;
+        }
+        if (p < end && (*p == '-' || *p == '+'))
+        {
+            neg = (*p++ == '-');
+        }
+        for (; p < end; p++)
+        {
+            if (*p == '.' && !point)
+            {
+                point = true;
+                continue;
+            }
+            if (*p < '0' || *p > '9')
+            {
+                break;
+            }
+            any = true;
+            frac += point;
+            if (ndig == 0 && *p == '0')
+            { // leading zero
+                continue;
+            }
+            if (ndig == MAX_DECIMAL_DIGITS)
+            {
+                return false;
+            }
+            digits[ndig++] = *p;
+        }
+        int exp = 0;
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            char *e = nullptr;
+            exp = (int)strtol(p + 1, &e, 10);
+            if (e == p + 1)
+            {
+                return false;
+            }
+            p = e;
+        }
+        while (p < end && *p == ' ')
+        {
+            p++;
+        }
+        if (!any || p != end)
+        {
+            return false;
+        }
+
+        // digits * 10^shift is the unscaled value: the first keep digits, rounded on the next one
+        int shift = scale - frac + exp;
+        int keep = (shift < 0) ? ndig + shift : ndig;
+        if (keep + (shift > 0 ? shift : 0) > precision)
+        {
+            return false;
+        }
+        for (int k = 0; k < precision; k++)
+        {
+            limit *= 10;
+        }
+        v = 0;
+        for (int k = 0; k < keep; k++)
+        {
+            v = v * 10 + (digits[k] - '0');
+        }
+        for (int k = 0; k < shift; k++)
+        {
+            v *= 10;
+        }
+        if (keep >= 0 && keep < ndig && digits[keep] >= '5')
+        {
+            v++;
+        }
+        if (v >= limit)
+        {
+            return false;
+        }
+        if (neg)
+        {
+            v = -v;
+        }
+        return true;
+    }
+
+    // Thrift compact protocol, enough for the Parquet page headers and footer
+    class ThriftCompact
+    {
+        std::vector<uint8_t> &out;
+        std::vector<int16_t> fields; // last field id of the enclosing structs
+
+        void header(int16_t id, uint8_t type)
+        {
+            int delta = id - fields.back();
+            if (delta > 0 && delta <= 15)
+            {
+                out.push_back((uint8_t)(delta << 4 | type));
+            }
+            else
+            {
+                out.push_back(type);
+                varint(((uint64_t)id << 1) ^ (uint64_t)(id >> 15));
+            }
+            fields.back() = id;
+        }
+
+    public:
+        enum Types
+        {
+            T_TRUE = 1,
+            T_FALSE = 2,
+            T_I32 = 5,
+            T_I64 = 6,
+            T_BINARY = 8,
+            T_LIST = 9,
+            T_STRUCT = 12
+        };
+
+        explicit ThriftCompact(std::vector<uint8_t> &o) : out(o), fields(1, 0) {}
+
+        void varint(uint64_t v)
+        {
+            while (v >= 0x80)
+            {
+                out.push_back((uint8_t)(v | 0x80));
+                v >>= 7;
+            }
+            out.push_back((uint8_t)v);
+        }
+
+        void i32(int16_t id, int32_t v)
+        {
+            header(id, T_I32);
+            element(v);
+        }
+
+        void boolean(int16_t id, bool v)
+        {
+            header(id, v ? T_TRUE : T_FALSE);
+        }
+
+        void i64(int16_t id, int64_t v)
+        {
+            header(id, T_I64);
+            varint(((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+        }
+
+        void binary(int16_t id, const std::string &s)
+        {
+            header(id, T_BINARY);
+            element(s);
+        }
+
+        void element(const std::string &s)
+        {
+            varint(s.size());
+            out.insert(out.end(), s.begin(), s.end());
+        }
+
+        void element(int32_t v)
+        {
+            varint(((uint32_t)v << 1) ^ (uint32_t)(v >> 31));
+        }
+
+        void list(int16_t id, uint8_t type, size_t n)
+        {
+            header(id, T_LIST);
+            if (n < 15)
+            {
+                out.push_back((uint8_t)(n << 4 | type));
+            }
+            else
+            {
+                out.push_back((uint8_t)(0xf0 | type));
+                varint(n);
+            }
+        }
+
+        // A struct field (id > 0) or a struct element of a list (id 0)
+        void begin(int16_t id = 0)
+        {
+            if (id)
+            {
+                header(id, T_STRUCT);
+            }
+            fields.push_back(0);
+        }
+
+        void end()
+        {
+            out.push_back(0);
+            fields.pop_back();
+        }
+    };
+
+    // Values of one column: the data page being encoded, and the compressed pages of the row group
+    struct ParquetChunk
+    {
+        ParquetColumn col;
+        std::vector<uint8_t> values; // PLAIN values of the page
+        std::vector<uint8_t> defs;   // definition levels of the page, one bit per row
+        size_t pageRows = 0;
+        size_t pageNulls = 0;
+        size_t bools = 0;           // BOOLEAN values of the page, bit packed in values
+        std::vector<uint8_t> pages; // page headers and compressed pages of the row group
+        int64_t numValues = 0;
+        int64_t uncompressed = 0;
+        int64_t compressed = 0;
+        double ratio = 1.0; // compressed/encoded bytes of the last page, to estimate the page being encoded
+        std::string error;
+    };
+
+    struct ParquetChunkMeta
+    {
+        int64_t offset;
+        int64_t numValues;
+        int64_t uncompressed;
+        int64_t compressed;
+    };
+
+    struct ParquetRowGroup
+    {
+        int64_t rows;
+        std::vector<ParquetChunkMeta> chunks;
+    };
+
+    class ParquetWriter
+    {
+        std::vector<ParquetChunk> chunks;
+        std::vector<ParquetRowGroup> groups;
+        ParquetCodecs codec;
+        size_t pageBytes;
+        std::string path;
+        int fd = -1;
+        int64_t written = 0;  // bytes of the file
+        int64_t buffered = 0; // compressed pages of the row group
+        int64_t groupRows = 0;
+        int64_t fileRows = 0;
+
+        inline void defined(ParquetChunk &c, bool set)
+        {
+            if (c.pageRows % 8 == 0)
+            {
+                c.defs.push_back(0);
+            }
+            if (set)
+            {
+                c.defs.back() |= (uint8_t)(1 << (c.pageRows % 8));
+            }
+            else
+            {
+                c.pageNulls++;
+            }
+            c.pageRows++;
+        }
+
+        inline void append(ParquetChunk &c, const void *v, size_t n)
+        {
+            defined(c, true);
+            c.values.insert(c.values.end(), (const uint8_t *)v, (const uint8_t *)v + n);
+        }
+
+        inline void appendInt64(size_t j, int64_t v)
+        {
+            append(chunks[j], &v, sizeof(v)); // little endian hosts
+        }
+
+        bool writeAll(const uint8_t *p, size_t n, std::string &error)
+        {
+            while (n > 0)
+            {
+                ssize_t w = ::write(fd, p, n);
+                if (w < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (w <= 0)
+                {
+                    error = "writing " + path + ": " + strerror(errno);
+                    return false;
+                }
+                p += w;
+                n -= (size_t)w;
+                written += w;
+            }
+            return true;
+        }
+
+    public:
+        ParquetWriter(const std::vector<ParquetColumn> &cols, ParquetCodecs c) : chunks(cols.size()), codec(c), pageBytes(parquetPageBytes(cols.size()))
+        {
+            for (size_t j = 0; j < cols.size(); j++)
+            {
+                chunks[j].col = cols[j];
+            }
+        }
+
+        ~ParquetWriter()
+        {
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+        }
+
+        // Creates the file, which must not exist
+        bool open(const std::string &file, std::string &error)
+        {
+            path = file;
+            written = 0;
+            fileRows = 0;
+            groups.clear();
+            if ((fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644)) < 0)
+            {
+                error = "creating " + path + ": " + strerror(errno);
+                return false;
+            }
+            return writeAll((const uint8_t *)"PAR1", 4, error);
+        }
+
+        // Converts rows [0, nrows) of the bound column j. errrow is the row of a failed conversion
+        ConvertStatus appendColumn(size_t j, SQLSMALLINT Odt, bool textInt, SQLPOINTER Ores, SQLLEN *Olen, size_t desz, size_t nrows, size_t &errrow)
+        {
+            for (size_t i = 0; i < nrows; i++)
+            {
+                ConvertStatus rc = convertValue(*this, j, Odt, textInt, (SQLPOINTER)((uint8_t *)Ores + desz * i), Olen[i], desz);
+                if (rc != CONVERT_OK)
+                {
+                    errrow = i;
+                    return rc;
+                }
+                if (chunks[j].values.size() >= pageBytes || chunks[j].pageRows >= PARQUET_PAGE_ROWS)
+                {
+                    flushPage(j);
+                }
+            }
+            return CONVERT_OK;
+        }
+
+        // Compresses the page being encoded of column j into the pages of the row group
+        void flushPage(size_t j)
+        {
+            ParquetChunk &c = chunks[j];
+            std::vector<uint8_t> raw;
+            std::vector<uint8_t> levels;
+            std::vector<uint8_t> header;
+            ThriftCompact levelRuns(levels);
+
+            if (c.pageRows == 0)
+            {
+                return;
+            }
+
+            // Definition levels, RLE/bit-packed hybrid of bit width 1: one run when there is no null
+            if (c.pageNulls == 0)
+            {
+                levelRuns.varint((uint64_t)c.pageRows << 1);
+                levels.push_back(1);
+            }
+            else
+            {
+                levelRuns.varint((uint64_t)c.defs.size() << 1 | 1);
+                levels.insert(levels.end(), c.defs.begin(), c.defs.end());
+            }
+            uint32_t n = (uint32_t)levels.size();
+            raw.reserve(4 + levels.size() + c.values.size());
+            raw.insert(raw.end(), (uint8_t *)&n, (uint8_t *)&n + 4);
+            raw.insert(raw.end(), levels.begin(), levels.end());
+            raw.insert(raw.end(), c.values.begin(), c.values.end());
+
+            std::vector<uint8_t> packed;
+            const std::vector<uint8_t> *data = &raw;
+            if (codec == PQ_GZIP)
+            {
+                z_stream zs;
+                memset(&zs, 0, sizeof(zs));
+                if (deflateInit2(&zs, PARQUET_GZIP_LEVEL, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+                {
+                    c.error = "zlib initialization failed";
+                    return;
+                }
+                packed.resize(deflateBound(&zs, raw.size()));
+                zs.next_in = raw.data();
+                zs.avail_in = (uInt)raw.size();
+                zs.next_out = packed.data();
+                zs.avail_out = (uInt)packed.size();
+                int rc = deflate(&zs, Z_FINISH);
+                packed.resize(zs.total_out);
+                deflateEnd(&zs);
+                if (rc != Z_STREAM_END)
+                {
+                    c.error = "zlib compression failed";
+                    return;
+                }
+                data = &packed;
+            }
+
+            ThriftCompact h(header);
+            h.i32(1, 0); // DATA_PAGE
+            h.i32(2, (int32_t)raw.size());
+            h.i32(3, (int32_t)data->size());
+            h.begin(5);
+            h.i32(1, (int32_t)c.pageRows);
+            h.i32(2, 0); // PLAIN
+            h.i32(3, 3); // RLE
+            h.i32(4, 3);
+            h.end();
+            header.push_back(0);
+
+            c.pages.insert(c.pages.end(), header.begin(), header.end());
+            c.pages.insert(c.pages.end(), data->begin(), data->end());
+            c.numValues += (int64_t)c.pageRows;
+            c.uncompressed += (int64_t)(header.size() + raw.size());
+            c.compressed += (int64_t)(header.size() + data->size());
+            c.ratio = (double)data->size() / (double)raw.size();
+            c.values.clear();
+            c.defs.clear();
+            c.pageRows = 0;
+            c.pageNulls = 0;
+            c.bools = 0;
+        }
+
+        // Counts the nrows rows just appended to every column. True when the row group is due
+        bool endRows(size_t nrows)
+        {
+            groupRows += (int64_t)nrows;
+            fileRows += (int64_t)nrows;
+            buffered = 0;
+            for (auto &c : chunks)
+            {
+                buffered += (int64_t)c.pages.size() + (int64_t)((double)c.values.size() * c.ratio);
+            }
+            return buffered >= PARQUET_ROW_GROUP_BYTES;
+        }
+
+        // Writes the column chunks of the row group. The pages left are flushed here unless done by the caller
+        bool writeRowGroup(std::string &error)
+        {
+            ParquetRowGroup g;
+
+            if (groupRows == 0)
+            {
+                return true;
+            }
+            g.rows = groupRows;
+            for (size_t j = 0; j < chunks.size(); j++)
+            {
+                ParquetChunk &c = chunks[j];
+                flushPage(j);
+                if (!c.error.empty())
+                {
+                    error = c.error;
+                    return false;
+                }
+                g.chunks.push_back({written, c.numValues, c.uncompressed, c.compressed});
+                if (!writeAll(c.pages.data(), c.pages.size(), error))
+                {
+                    return false;
+                }
+                c.pages.clear();
+                c.numValues = 0;
+                c.uncompressed = 0;
+                c.compressed = 0;
+            }
+            groups.push_back(std::move(g));
+            groupRows = 0;
+            buffered = 0;
+            return true;
+        }
+
+        // Writes the last row group and the footer, and closes the file
+        bool close(std::string &error)
+        {
+            std::vector<uint8_t> footer;
+            ThriftCompact f(footer);
+            int64_t total = 0;
+
+            if (!writeRowGroup(error))
+            {
+                return false;
+            }
+
+            // FileMetaData:
+            f.i32(1, 1);
+            f.list(2, ThriftCompact::T_STRUCT, chunks.size() + 1);
+            f.begin();
+            f.binary(4, "schema");
+            f.i32(5, (int32_t)chunks.size());
+            f.end();
+            for (auto &c : chunks)
+            {
+                f.begin();
+                f.i32(1, c.col.type);
+                if (c.col.type == PQ_FIXED_LEN_BYTE_ARRAY)
+                {
+                    f.i32(2, PARQUET_DECIMAL_BYTES);
+                }
+                f.i32(3, 1); // OPTIONAL
+                f.binary(4, c.col.name);
+                if (c.col.converted == PQ_TIME_MICROS || c.col.converted == PQ_TIMESTAMP_MICROS)
+                { // LogicalType TIME or TIMESTAMP (MICROS) not adjusted to UTC, without the legacy converted type implying UTC
+                    f.begin(10);
+                    f.begin(c.col.converted == PQ_TIME_MICROS ? 7 : 8);
+                    f.boolean(1, false);
+                    f.begin(2);
+                    f.begin(2);
+                    f.end();
+                    f.end();
+                    f.end();
+                    f.end();
+                }
+                else if (c.col.converted != PQ_NONE)
+                {
+                    f.i32(6, c.col.converted);
+                }
+                if (c.col.converted == PQ_DECIMAL)
+                {
+                    f.i32(7, c.col.scale);
+                    f.i32(8, c.col.precision);
+                }
+                f.end();
+            }
+            for (auto &g : groups)
+            {
+                total += g.rows;
+            }
+            f.i64(3, total);
+            f.list(4, ThriftCompact::T_STRUCT, groups.size());
+            for (auto &g : groups)
+            {
+                int64_t bytes = 0;
+                f.begin();
+                f.list(1, ThriftCompact::T_STRUCT, g.chunks.size());
+                for (size_t j = 0; j < g.chunks.size(); j++)
+                {
+                    const ParquetChunkMeta &m = g.chunks[j];
+                    f.begin();
+                    f.i64(2, m.offset);
+                    f.begin(3); // ColumnMetaData
+                    f.i32(1, chunks[j].col.type);
+                    f.list(2, ThriftCompact::T_I32, 2);
+                    f.element((int32_t)0); // PLAIN
+                    f.element((int32_t)3); // RLE
+                    f.list(3, ThriftCompact::T_BINARY, 1);
+                    f.element(chunks[j].col.name);
+                    f.i32(4, codec);
+                    f.i64(5, m.numValues);
+                    f.i64(6, m.uncompressed);
+                    f.i64(7, m.compressed);
+                    f.i64(9, m.offset);
+                    f.end();
+                    f.end();
+                    bytes += m.uncompressed;
+                }
+                f.i64(2, bytes);
+                f.i64(3, g.rows);
+                f.end();
+            }
+            f.binary(6, "DBLINK");
+            footer.push_back(0);
+
+            uint32_t n = (uint32_t)footer.size();
+            footer.insert(footer.end(), (uint8_t *)&n, (uint8_t *)&n + 4);
+            footer.insert(footer.end(), {'P', 'A', 'R', '1'});
+            if (!writeAll(footer.data(), footer.size(), error))
+            {
+                return false;
+            }
+            if (::close(fd) != 0)
+            {
+                fd = -1;
+                error = "closing " + path + ": " + strerror(errno);
+                return false;
+            }
+            fd = -1;
+            return true;
+        }
+
+        // Bytes of the file once the buffered row group is written
+        int64_t size() const
+        {
+            return written + buffered;
+        }
+
+        int64_t rows() const
+        {
+            return fileRows;
+        }
+
+        // First error of the page compression of a column
+        bool failed(std::string &error) const
+        {
+            for (auto &c : chunks)
+            {
+                if (!c.error.empty())
+                {
+                    error = c.error;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Writer members of dblink_convert.h:
+        inline void setNull(size_t j)
+        {
+            defined(chunks[j], false);
+        }
+        inline void setInt(size_t j, int64_t v)
+        {
+            appendInt64(j, v);
+        }
+        inline void setFloat(size_t j, double v)
+        {
+            append(chunks[j], &v, sizeof(v));
+        }
+        inline bool setNumeric(size_t j, char *text, size_t len)
+        {
+            ParquetChunk &c = chunks[j];
+            __int128 v = 0;
+
+            if (c.col.converted != PQ_DECIMAL)
+            {
+                setString(j, text, strnlen(text, len));
+                return true;
+            }
+            if (!parseDecimal(text, len, c.col.precision, c.col.scale, v))
+            {
+                return false;
+            }
+            if (c.col.type == PQ_INT64)
+            {
+                appendInt64(j, (int64_t)v);
+                return true;
+            }
+            uint8_t be[PARQUET_DECIMAL_BYTES];
+            for (int k = PARQUET_DECIMAL_BYTES - 1; k >= 0; k--)
+            { // big endian two's complement
+                be[k] = (uint8_t)(v & 0xff);
+                v >>= 8;
+            }
+            append(c, be, sizeof(be));
+            return true;
+        }
+        inline void setString(size_t j, const char *s, size_t len)
+        {
+            ParquetChunk &c = chunks[j];
+            uint32_t n = (uint32_t)len;
+            append(c, &n, 4);
+            c.values.insert(c.values.end(), (const uint8_t *)s, (const uint8_t *)s + len);
+        }
+        inline void setBool(size_t j, bool v)
+        {
+            ParquetChunk &c = chunks[j];
+            defined(c, true);
+            if (c.bools % 8 == 0)
+            {
+                c.values.push_back(0);
+            }
+            if (v)
+            {
+                c.values.back() |= (uint8_t)(1 << (c.bools % 8));
+            }
+            c.bools++;
+        }
+        inline void setDate(size_t j, int64_t days)
+        {
+            int32_t d = (int32_t)(days + PARQUET_EPOCH_DAYS);
+            append(chunks[j], &d, sizeof(d));
+        }
+        inline void setTime(size_t j, int64_t us)
+        {
+            appendInt64(j, us);
+        }
+        inline void setTimestamp(size_t j, int64_t us)
+        {
+            appendInt64(j, us + PARQUET_EPOCH_DAYS * CONVERT_US_PER_DAY);
+        }
+        inline void setInterval(size_t j, int64_t v)
+        {
+            appendInt64(j, v);
+        }
+    };
+}
+
+#endif
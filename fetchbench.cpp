@@ -0,0 +1,171 @@
+// Fetch loop benchmark of direct_fetch (dblink_direct.h) against the driver manager.
+// Builds without the Vertica SDK: make fetchbench DSN=... QUERY=... [ROWSET=1000] [THREADS=1] [ROUNDS=3]
+// Each thread connects to DSN, runs QUERY with the columns bound as text (as DBLINK binds
+// Oracle NUMBER), and fetches the whole result set once per mode. The modes alternate over the rounds,
+// each round starting with the other one, so that neither always runs on a warmer remote cache.
+// Reports rows/s and ns/rowset of the fetch loop only, connection and execution excluded.
+
+#include "dblink_direct.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define FETCHBENCH_COLSIZE 257 // Text buffer per column value
+
+using namespace DBLINK;
+
+struct Result
+{
+    unsigned long rows = 0;
+    unsigned long rowsets = 0;
+    double ns = 0;
+    std::string error;
+};
+
+static std::string diag(SQLSMALLINT htype, SQLHANDLE Oh)
+{
+    SQLCHAR Oerr_state[6];
+    SQLINTEGER Oerr_native = 0;
+    SQLCHAR Oerr_text[1024];
+    SQLSMALLINT Oln = 0;
+
+    if (!SQL_SUCCEEDED(SQLGetDiagRec(htype, Oh, 1, Oerr_state, &Oerr_native, Oerr_text, (SQLSMALLINT)sizeof(Oerr_text), &Oln)))
+    {
+        return "no diagnostic record";
+    }
+    return std::string((char *)Oerr_state) + " " + (char *)Oerr_text;
+}
+
+// Runs the query once and fetches it through the driver manager (direct false) or the driver
+static void run(const std::string &dsn, const std::string &query, size_t rowset, bool direct, Result &r)
+{
+    SQLHENV Oenv = SQL_NULL_HENV;
+    SQLHDBC Ocon = SQL_NULL_HDBC;
+    SQLHSTMT Ost = SQL_NULL_HSTMT;
+    SQLSMALLINT Oncol = 0;
+    SQLULEN nfr = 0;
+    SQLRETURN Oret = 0;
+    DirectFetch df;
+    std::vector<std::vector<char>> Ores;
+    std::vector<std::vector<SQLLEN>> Olen;
+
+    SQLAllocHandle(SQL_HANDLE_ENV, SQL_NULL_HANDLE, &Oenv);
+    SQLSetEnvAttr(Oenv, SQL_ATTR_ODBC_VERSION, (void *)SQL_OV_ODBC3, 0);
+    SQLAllocHandle(SQL_HANDLE_DBC, Oenv, &Ocon);
+    if (!SQL_SUCCEEDED(SQLDriverConnect(Ocon, NULL, (SQLCHAR *)dsn.c_str(), SQL_NTS, NULL, 0, NULL, SQL_DRIVER_NOPROMPT)))
+    {
+        r.error = "connect: " + diag(SQL_HANDLE_DBC, Ocon);
+        goto done;
+    }
+    SQLAllocHandle(SQL_HANDLE_STMT, Ocon, &Ost);
+    if (!SQL_SUCCEEDED(SQLExecDirect(Ost, (SQLCHAR *)query.c_str(), SQL_NTS)))
+    {
+        r.error = "execute: " + diag(SQL_HANDLE_STMT, Ost);
+        goto done;
+    }
+    SQLNumResultCols(Ost, &Oncol);
+    Ores.resize(Oncol, std::vector<char>(FETCHBENCH_COLSIZE * rowset));
+    Olen.resize(Oncol, std::vector<SQLLEN>(rowset));
+    for (SQLSMALLINT j = 0; j < Oncol; j++)
+    {
+        SQLBindCol(Ost, j + 1, SQL_C_CHAR, Ores[j].data(), FETCHBENCH_COLSIZE, Olen[j].data());
+    }
+    SQLSetStmtAttr(Ost, SQL_ATTR_ROW_BIND_TYPE, (SQLPOINTER)SQL_BIND_BY_COLUMN, 0);
+    SQLSetStmtAttr(Ost, SQL_ATTR_ROW_ARRAY_SIZE, (SQLPOINTER)rowset, 0);
+    SQLSetStmtAttr(Ost, SQL_ATTR_ROWS_FETCHED_PTR, &nfr, 0);
+    if (direct && !df.open(Ocon, Ost, r.error))
+    {
+        r.error = "direct_fetch unavailable: " + r.error;
+        goto done;
+    }
+
+    {
+        auto start = std::chrono::steady_clock::now();
+        while (SQL_SUCCEEDED(Oret = direct ? df.fetch() : SQLFetchScroll(Ost, SQL_FETCH_NEXT, 0)) && Oret != SQL_NO_DATA)
+        {
+            r.rows += nfr;
+            r.rowsets++;
+        }
+        auto end = std::chrono::steady_clock::now();
+        r.ns = std::chrono::duration<double, std::nano>(end - start).count();
+    }
+    if (Oret == SQL_ERROR)
+    {
+        r.error = "fetch: " + (direct ? df.diag() : diag(SQL_HANDLE_STMT, Ost));
+    }
+
+done:
+    df.close();
+    if (Ost)
+    {
+        SQLFreeStmt(Ost, SQL_CLOSE);
+        SQLFreeHandle(SQL_HANDLE_STMT, Ost);
+    }
+    SQLDisconnect(Ocon);
+    SQLFreeHandle(SQL_HANDLE_DBC, Ocon);
+    SQLFreeHandle(SQL_HANDLE_ENV, Oenv);
+}
+
+// Fetch loop throughput of the threads running together: the sum of their rows/s over their own fetch loop
+static bool report(const char *name, const std::string &dsn, const std::string &query, size_t rowset, size_t nthreads, bool direct)
+{
+    std::vector<Result> results(nthreads);
+    std::vector<std::thread> threads;
+    unsigned long rowsets = 0;
+    double rps = 0;
+    double ns = 0;
+
+    for (size_t t = 0; t < nthreads; t++)
+    {
+        threads.emplace_back(run, std::cref(dsn), std::cref(query), rowset, direct, std::ref(results[t]));
+    }
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+    for (auto &r : results)
+    {
+        if (!r.error.empty())
+        {
+            fprintf(stderr, "%s: %s\n", name, r.error.c_str());
+            return false;
+        }
+        rowsets += r.rowsets;
+        rps += r.ns > 0 ? r.rows / (r.ns / 1e9) : 0.0;
+        ns += r.ns;
+    }
+    printf("%-16s %12.0f rows/s %10.0f ns/rowset\n", name, rps, rowsets ? ns / rowsets : 0.0);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: %s CONNECTION_STRING QUERY [ROWSET] [THREADS] [ROUNDS]\n", argv[0]);
+        return 2;
+    }
+    std::string dsn = argv[1];
+    std::string query = argv[2];
+    size_t rowset = argc > 3 ? strtoul(argv[3], NULL, 10) : 1000;
+    size_t nthreads = argc > 4 ? strtoul(argv[4], NULL, 10) : 1;
+    size_t rounds = argc > 5 ? strtoul(argv[5], NULL, 10) : 3;
+
+    printf("DBLINK fetch loop, %zu rows per rowset, %zu threads, %zu rounds\n", rowset, nthreads, rounds);
+    for (size_t round = 0; round < rounds; round++)
+    {
+        for (bool direct : {round % 2 == 1, round % 2 == 0})
+        {
+            if (!report(direct ? "direct_fetch" : "driver manager", dsn, query, rowset, nthreads, direct))
+            {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
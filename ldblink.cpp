@@ -1,5 +1,8 @@
 #include "Vertica.h"
 #include "StringParsers.h"
+#include "dblink_convert.h"
+#include "dblink_direct.h"
+#include "dblink_parquet.h"
 
 using namespace Vertica;
 using namespace std;
@@ -11,9 +14,45 @@ using namespace std;
 #include <fstream>
 #include <memory>
 #include <cstdlib>
+#include <map>
+#include <limits>
+#include <unordered_set>
+#include <chrono>
+#include <functional>
+#include <cstdarg>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/file.h>
+#include <sys/stat.h>
 #ifdef DBLINK_DEBUG
 #include <malloc.h>
 #endif
+#ifdef DBLINK_ADBC
+#include <adbc.h>
+#include <atomic>
+#endif
+#ifdef DBLINK_LIBPQ
+#include <libpq-fe.h>
+#include <odbcinst.h>
+#include <endian.h>
+#endif
+#ifdef DBLINK_SDT
+#include <sys/sdt.h>
+#endif
+#include <sys/syscall.h>
+
+// Static tracepoints (USDT) of provider "dblink", single nop instructions until perf/bpftrace attach to them:
+#ifdef DBLINK_SDT
+#define DBLINK_PROBE(name) DTRACE_PROBE(dblink, name)
+#define DBLINK_PROBE1(name, a) DTRACE_PROBE1(dblink, name, a)
+#define DBLINK_PROBE2(name, a, b) DTRACE_PROBE2(dblink, name, a, b)
+#else
+#define DBLINK_PROBE(name)
+#define DBLINK_PROBE1(name, a)
+#define DBLINK_PROBE2(name, a, b)
+#endif
 
 #define DBLINK_CIDS "/usr/local/etc/dblink.cids" // Default Connection identifiers config file
 #define MAXCNAMELEN 128                          // Max column name length
@@ -25,6 +64,31 @@ using namespace std;
 #define MAX_BINARY_LEN 65000                     // Max [VAR]BINARY length
 #define MAX_LONGBINARY_LEN 32000000              // Max LONGVARBINARY length
 #define MAX_ODBC_ERROR_LEN 1024                  // Max ODBC Error length
+#define MAX_DSN_VALUE_LEN 1024                   // Max length of a value read from odbc.ini
+#define DBLINK_GOVERNOR_DIR "/tmp/dblink-governor" // Slot and queue files of the per CID governor
+#define GOVERNOR_POLL_US 5000                    // Governor queue polling interval, doubled up to GOVERNOR_MAX_POLL_US
+#define GOVERNOR_MAX_POLL_US 200000              // Longest governor queue polling interval
+#define DEF_QUEUE_TIMEOUT 600                    // Default governor queue timeout in seconds
+#define DEF_PRIORITY 50                          // Default governor queue priority
+#define MAX_PRIORITY 999                         // Max governor queue priority
+#define PG_BULK_BUFFER 1048576                   // COPY FROM STDIN data buffered per PQputCopyData
+#define MAX_WORKERS 16                           // Max conversion threads per DBLINK instance
+#define DEF_MAX_RETRIES 3                        // Default reconnections of a resumable extraction
+#define RETRY_STEP_MS 100                        // Cancel check interval while waiting to resume
+#define MAX_RETRY_WAIT 60                        // Max seconds between reconnections
+#define CHECKPOINT_SECONDS 10                    // Min seconds between checkpoint file writes
+#define DBLINK_WIDTHS_DIR "/tmp/dblink-widths"   // Observed widths of the string columns (width_sample)
+#define WIDTH_CACHE_SECONDS 86400                // Seconds before the widths of a query are sampled again
+#define NARROW_FACTOR 2                          // Declared width of a sampled column, times its longest value
+#define NARROW_MIN_WIDTH 16                      // Min declared width of a sampled column
+#define FILTER_KEYS 1000                         // Keys per IN-list of a filter_key query (Oracle max)
+#define HEDGE_HISTORY 200                        // First rowset latencies kept per replica group
+#define HEDGE_MIN_SAMPLES 20                     // Latencies needed before a query is hedged
+#define HEDGE_MIN_DELAY_MS 50                    // Min delay before a query is sent to a second replica
+#define HANDOFF_SECONDS 60                       // Max seconds a statement prepared while planning waits for its instance
+#define DEF_PARQUET_FILE_MB 256                  // Default size of the Parquet files before they are rolled
+#define MAX_PARQUET_FILE_MB 65536                // Max size of the Parquet files
+#define MAX_PARQUET_PATH 4096                    // Max length of a Parquet file name
 
 namespace DBLINK
 {
@@ -36,11 +100,15 @@ namespace DBLINK
         SQLSERVER,
         TERADATA,
         ORACLE,
-        MYSQL
+        MYSQL,
+        SYBASE
     };
 
-    void getCidValue(ServerInterface &srvInterface, std::string &cidValue)
+    // Reads the connection string of the CID. A replica group ("REPLICAS=cid1,cid2,...") resolves to its first
+    // member, replicas receiving the connection strings of all the members
+    void getCidValue(ServerInterface &srvInterface, std::string &cidValue, std::vector<std::string> *replicas = nullptr)
     {
+        std::map<std::string, std::string> entries;
         std::string cid = "";
         std::string cid_env = "";
         std::string cid_file = DBLINK_CIDS;
@@ -125,6 +193,7 @@ namespace DBLINK
                     if ((pos = cline.find(":")) != std::string::npos)
                     {
                         cid_name = cline.substr(0, pos);
+                        entries[cid_name] = cline.substr(pos + 1, std::string::npos);
                         if (cid_name == cid)
                         {
                             cid_value = cline.substr(pos + 1, std::string::npos);
@@ -163,10 +232,638 @@ namespace DBLINK
             {
                 vt_report_error(105, "DBLINK. Error finding CID <%s> in <%s>", cid.c_str(), DBLINK_CIDS);
             }
+            if (!strncasecmp(cid_value.c_str(), "REPLICAS=", 9))
+            {
+                std::stringstream members(cid_value.substr(9));
+                std::string member;
+                std::vector<std::string> values;
+                while (std::getline(members, member, ','))
+                {
+                    member.erase(0, member.find_first_not_of(" \t"));
+                    member.erase(member.find_last_not_of(" \t") + 1);
+                    auto it = entries.find(member);
+                    if (it == entries.end() || !strncasecmp(it->second.c_str(), "REPLICAS=", 9))
+                    {
+                        vt_report_error(105, "DBLINK. Error finding replica <%s> of CID <%s> in <%s>", member.c_str(), cid.c_str(), cid_file.c_str());
+                    }
+                    values.push_back(it->second);
+                }
+                if (values.empty())
+                {
+                    vt_report_error(105, "DBLINK. Error replica group <%s> has no members", cid.c_str());
+                }
+                cid_value = values[0];
+                if (replicas)
+                {
+                    *replicas = values;
+                }
+            }
         }
         cidValue = cid_value;
     }
 
+    DBs getDbType(const char *dbmsName)
+    {
+        if (!strcmp(dbmsName, "Oracle"))
+        {
+            return ORACLE;
+        }
+        else if (!strcmp(dbmsName, "PostgreSQL"))
+        {
+            return POSTGRES;
+        }
+        else if (!strncmp(dbmsName, "Vertica", 7))
+        {
+            return VERTICA;
+        }
+        else if (!strcmp(dbmsName, "Microsoft SQL Server"))
+        {
+            return SQLSERVER;
+        }
+        else if (!strncmp(dbmsName, "Teradata", 8))
+        {
+            return TERADATA;
+        }
+        else if (!strcmp(dbmsName, "MySQL") || !strcmp(dbmsName, "MariaDB"))
+        {
+            return MYSQL;
+        }
+        else if (!strcmp(dbmsName, "Adaptive Server Enterprise") || !strcmp(dbmsName, "SQL Server"))
+        {
+            return SYBASE;
+        }
+        return GENERIC;
+    }
+
+    // True for drivers that run the whole query when a prepared statement is described
+    bool describeExecutes(DBs dbt)
+    {
+        return dbt == MYSQL || dbt == TERADATA || dbt == SQLSERVER || dbt == SYBASE;
+    }
+
+    // Wraps query so that describing it does not run it on drivers that execute on describe
+    std::string getDescribeQuery(DBs dbt, const std::string &query)
+    {
+        std::string q = query.substr(0, query.find_last_not_of(" \n\t\r;") + 1);
+        if (dbt == MYSQL)
+        {
+            return "SELECT * FROM (" + q + ") dblink_describe LIMIT 0";
+        }
+        else if (describeExecutes(dbt))
+        {
+            return "SELECT * FROM (" + q + ") dblink_describe WHERE 1=0";
+        }
+        return query;
+    }
+
+    // Reads an optional "(n[,m])" type modifier
+    void getTypeModifiers(const std::string &type, int32 &m1, int32 &m2)
+    {
+        size_t pos = type.find('(');
+        if (pos != std::string::npos)
+        {
+            (void)sscanf(type.c_str() + pos + 1, "%d , %d", &m1, &m2);
+        }
+    }
+
+    // Builds the output columns from the "schema" parameter ("name TYPE[(n[,m])], ..."),
+    // returning the bytes per row needed to bind them
+    size_t parseSchema(const std::string &schema, SizedColumnTypes &outputTypes)
+    {
+        std::vector<std::string> cols;
+        std::string col = "";
+        int depth = 0;
+        size_t rowsize = 0;
+
+        for (char c : schema)
+        { // split on top level commas
+            if (c == '(')
+            {
+                depth++;
+            }
+            else if (c == ')')
+            {
+                depth--;
+            }
+            if (c == ',' && depth == 0)
+            {
+                cols.push_back(col);
+                col.clear();
+            }
+            else
+            {
+                col += c;
+            }
+        }
+        cols.push_back(col);
+
+        for (auto &c : cols)
+        {
+            c.erase(0, c.find_first_not_of(" \n\t\r"));
+            c.erase(c.find_last_not_of(" \n\t\r") + 1);
+            size_t pos = c.find_first_of(" \n\t\r");
+            if (c.empty() || pos == std::string::npos)
+            {
+                vt_report_error(122, "DBLinkFactory. Malformed schema column definition <%s>", c.c_str());
+            }
+            std::string cname = c.substr(0, pos);
+            std::string type = c.substr(c.find_first_not_of(" \n\t\r", pos));
+            std::transform(type.begin(), type.end(), type.begin(), ::toupper);
+            cname.erase(std::remove(cname.begin(), cname.end(), '"'), cname.end());
+            std::string base = type.substr(0, type.find('('));
+            base.erase(base.find_last_not_of(" ") + 1);
+            int32 m1 = -1;
+            int32 m2 = -1;
+            getTypeModifiers(type, m1, m2);
+
+            rowsize += sizeof(SQLLEN);
+            if (base == "INT" || base == "INTEGER" || base == "BIGINT" || base == "SMALLINT" || base == "TINYINT" || base == "INT8")
+            {
+                rowsize += sizeof(vint);
+                outputTypes.addInt(cname);
+            }
+            else if (base == "FLOAT" || base == "FLOAT8" || base == "REAL" || base == "DOUBLE PRECISION")
+            {
+                rowsize += sizeof(vfloat);
+                outputTypes.addFloat(cname);
+            }
+            else if (base == "NUMERIC" || base == "DECIMAL" || base == "NUMBER")
+            {
+                rowsize += MAX_NUMERIC_CHARLEN;
+                outputTypes.addNumeric((m1 > 0) ? m1 : 37, (m2 >= 0) ? m2 : ((m1 > 0) ? 0 : 15), cname);
+            }
+            else if (base == "CHAR" || base == "CHARACTER")
+            {
+                m1 = (m1 > 0) ? std::min(m1, (int32)MAX_CHAR_LEN) : 1;
+                rowsize += (size_t)m1 + 1;
+                outputTypes.addChar(m1, cname);
+            }
+            else if (base == "VARCHAR" || base == "CHARACTER VARYING")
+            {
+                m1 = (m1 > 0) ? std::min(m1, (int32)MAX_CHAR_LEN) : 80;
+                rowsize += (size_t)m1 + 1;
+                outputTypes.addVarchar(m1, cname);
+            }
+            else if (base == "LONG VARCHAR")
+            {
+                m1 = (m1 > 0) ? std::min(m1, (int32)MAX_LONGCHAR_LEN) : 1048576;
+                rowsize += (size_t)m1 + 1;
+                outputTypes.addLongVarchar(m1, cname);
+            }
+            else if (base == "BINARY")
+            {
+                m1 = (m1 > 0) ? std::min(m1, (int32)MAX_BINARY_LEN) : 1;
+                rowsize += (size_t)m1 + 1;
+                outputTypes.addBinary(m1, cname);
+            }
+            else if (base == "VARBINARY")
+            {
+                m1 = (m1 > 0) ? std::min(m1, (int32)MAX_BINARY_LEN) : 80;
+                rowsize += (size_t)m1 + 1;
+                outputTypes.addVarbinary(m1, cname);
+            }
+            else if (base == "LONG VARBINARY")
+            {
+                m1 = (m1 > 0) ? std::min(m1, (int32)MAX_LONGBINARY_LEN) : 1048576;
+                rowsize += (size_t)m1 + 1;
+                outputTypes.addLongVarbinary(m1, cname);
+            }
+            else if (base == "DATE")
+            {
+                rowsize += sizeof(SQL_DATE_STRUCT);
+                outputTypes.addDate(cname);
+            }
+            else if (base == "TIME")
+            {
+                rowsize += sizeof(SQL_TIME_STRUCT);
+                outputTypes.addTime((m1 >= 0) ? m1 : 6, cname);
+            }
+            else if (base == "TIMESTAMP")
+            {
+                rowsize += sizeof(SQL_TIMESTAMP_STRUCT);
+                outputTypes.addTimestamp((m1 >= 0) ? m1 : 6, cname);
+            }
+            else if (base == "BOOLEAN" || base == "BOOL")
+            {
+                rowsize += 1;
+                outputTypes.addBool(cname);
+            }
+            else if (base == "INTERVAL YEAR TO MONTH")
+            {
+                rowsize += sizeof(SQL_INTERVAL_STRUCT);
+                outputTypes.addIntervalYM(INTERVAL_YEAR2MONTH, cname);
+            }
+            else if (base == "INTERVAL" || base == "INTERVAL DAY TO SECOND")
+            {
+                rowsize += sizeof(SQL_INTERVAL_STRUCT);
+                outputTypes.addInterval((m1 >= 0) ? m1 : 6, INTERVAL_DAY2SECOND, cname);
+            }
+            else
+            {
+                vt_report_error(122, "DBLinkFactory. Unsupported data type <%s> in schema for column %s", type.c_str(), cname.c_str());
+            }
+        }
+        return rowsize;
+    }
+
+    // True if a remote column of ODBC type Odt can be written to an output column of type vt
+    bool isCompatibleType(SQLSMALLINT Odt, const VerticaType &vt)
+    {
+        switch (Odt)
+        {
+        case SQL_SMALLINT:
+        case SQL_INTEGER:
+        case SQL_TINYINT:
+        case SQL_BIGINT:
+            return vt.isInt();
+        case SQL_REAL:
+        case SQL_DOUBLE:
+        case SQL_FLOAT:
+            return vt.isFloat();
+        case SQL_NUMERIC:
+        case SQL_DECIMAL:
+            return vt.isNumeric();
+        case SQL_CHAR:
+        case SQL_VARCHAR:
+        case SQL_WCHAR:
+        case SQL_WVARCHAR:
+        case SQL_LONGVARCHAR:
+        case SQL_WLONGVARCHAR:
+            return vt.isChar() || vt.isVarchar() || vt.isLongVarchar();
+        case SQL_BINARY:
+        case SQL_VARBINARY:
+        case SQL_LONGVARBINARY:
+            return vt.isBinary() || vt.isVarbinary() || vt.isLongVarbinary();
+        case SQL_TYPE_TIME:
+            return vt.isTime();
+        case SQL_TYPE_DATE:
+            return vt.isDate();
+        case SQL_TYPE_TIMESTAMP:
+            return vt.isTimestamp();
+        case SQL_BIT:
+            return vt.isBool();
+        case SQL_INTERVAL_YEAR_TO_MONTH:
+            return vt.isIntervalYM();
+        case SQL_INTERVAL_DAY_TO_SECOND:
+            return vt.isInterval();
+        default:
+            return false;
+        }
+    }
+
+    // ODBC parameter binding of an input column pushed to the target table: C type, SQL type,
+    // column size, decimal digits and bound element size. Returns false for unsupported types
+    bool getBulkParam(const VerticaType &vt, SQLSMALLINT &Oct, SQLSMALLINT &Opt, SQLULEN &Ocs, SQLSMALLINT &Odd, size_t &desz)
+    {
+        Ocs = 0;
+        Odd = 0;
+        if (vt.isInt())
+        {
+            Oct = SQL_C_SBIGINT;
+            Opt = SQL_BIGINT;
+            desz = sizeof(SQLBIGINT);
+        }
+        else if (vt.isFloat())
+        {
+            Oct = SQL_C_DOUBLE;
+            Opt = SQL_DOUBLE;
+            desz = sizeof(SQLDOUBLE);
+        }
+        else if (vt.isNumeric())
+        { // bound as text: digits, sign and decimal point
+            Oct = SQL_C_CHAR;
+            Opt = SQL_NUMERIC;
+            Ocs = (SQLULEN)vt.getNumericPrecision();
+            Odd = (SQLSMALLINT)vt.getNumericScale();
+            desz = std::max((size_t)MAX_NUMERIC_CHARLEN, (size_t)Ocs + 3);
+        }
+        else if (vt.isBool())
+        {
+            Oct = SQL_C_BIT;
+            Opt = SQL_BIT;
+            desz = sizeof(SQLCHAR);
+        }
+        else if (vt.isChar() || vt.isVarchar() || vt.isLongVarchar())
+        {
+            Oct = SQL_C_CHAR;
+            Opt = vt.isChar() ? SQL_CHAR : (vt.isVarchar() ? SQL_VARCHAR : SQL_LONGVARCHAR);
+            Ocs = (SQLULEN)std::max(vt.getStringLength(), (int32)1);
+            desz = (size_t)Ocs + 1;
+        }
+        else if (vt.isBinary() || vt.isVarbinary() || vt.isLongVarbinary())
+        {
+            Oct = SQL_C_BINARY;
+            Opt = vt.isBinary() ? SQL_BINARY : (vt.isVarbinary() ? SQL_VARBINARY : SQL_LONGVARBINARY);
+            Ocs = (SQLULEN)std::max(vt.getStringLength(), (int32)1);
+            desz = (size_t)Ocs;
+        }
+        else if (vt.isDate())
+        {
+            Oct = SQL_C_DATE;
+            Opt = SQL_TYPE_DATE;
+            Ocs = 10;
+            desz = sizeof(SQL_DATE_STRUCT);
+        }
+        else if (vt.isTime())
+        {
+            Oct = SQL_C_TIME;
+            Opt = SQL_TYPE_TIME;
+            Ocs = 8;
+            desz = sizeof(SQL_TIME_STRUCT);
+        }
+        else if (vt.isTimestamp() || vt.isTimestampTz())
+        { // TIMESTAMPTZ values are sent in UTC
+            Oct = SQL_C_TIMESTAMP;
+            Opt = SQL_TYPE_TIMESTAMP;
+            Ocs = 26;
+            Odd = 6;
+            desz = sizeof(SQL_TIMESTAMP_STRUCT);
+        }
+        else if (vt.isIntervalYM())
+        {
+            Oct = SQL_C_INTERVAL_YEAR_TO_MONTH;
+            Opt = SQL_INTERVAL_YEAR_TO_MONTH;
+            Ocs = 9;
+            desz = sizeof(SQL_INTERVAL_STRUCT);
+        }
+        else if (vt.isInterval())
+        {
+            Oct = SQL_C_INTERVAL_DAY_TO_SECOND;
+            Opt = SQL_INTERVAL_DAY_TO_SECOND;
+            Ocs = 9;
+            Odd = 6;
+            desz = sizeof(SQL_INTERVAL_STRUCT);
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+
+    // Copies input column j of the current row into the parameter buffer Odp (of desz bytes, as sized by getBulkParam)
+    void readParamValue(PartitionReader &inputReader, const VerticaType &vt, size_t j, SQLPOINTER Odp, size_t desz, SQLLEN &Odl)
+    {
+        if (inputReader.isNull(j))
+        {
+            Odl = SQL_NULL_DATA;
+        }
+        else if (vt.isInt())
+        {
+            *(SQLBIGINT *)Odp = (SQLBIGINT)inputReader.getIntRef(j);
+            Odl = sizeof(SQLBIGINT);
+        }
+        else if (vt.isFloat())
+        {
+            *(SQLDOUBLE *)Odp = (SQLDOUBLE)inputReader.getFloatRef(j);
+            Odl = sizeof(SQLDOUBLE);
+        }
+        else if (vt.isNumeric())
+        {
+            inputReader.getNumericRef(j).toString((char *)Odp, desz);
+            Odl = SQL_NTS;
+        }
+        else if (vt.isBool())
+        {
+            *(SQLCHAR *)Odp = (inputReader.getBoolRef(j) == VTrue) ? SQL_TRUE : SQL_FALSE;
+            Odl = sizeof(SQLCHAR);
+        }
+        else if (vt.isChar() || vt.isVarchar() || vt.isLongVarchar() ||
+                 vt.isBinary() || vt.isVarbinary() || vt.isLongVarbinary())
+        {
+            const VString &v = inputReader.getStringRef(j);
+            size_t len = std::min(v.length(), (size_t)std::max(vt.getStringLength(), (int32)1));
+            memcpy(Odp, v.data(), len);
+            Odl = (SQLLEN)len;
+        }
+        else if (vt.isDate())
+        {
+            toDateStruct(inputReader.getDateRef(j), *(SQL_DATE_STRUCT *)Odp);
+            Odl = sizeof(SQL_DATE_STRUCT);
+        }
+        else if (vt.isTime())
+        {
+            toTimeStruct(inputReader.getTimeRef(j), *(SQL_TIME_STRUCT *)Odp);
+            Odl = sizeof(SQL_TIME_STRUCT);
+        }
+        else if (vt.isTimestamp() || vt.isTimestampTz())
+        {
+            toTimestampStruct(vt.isTimestampTz() ? inputReader.getTimestampTzRef(j) : inputReader.getTimestampRef(j), *(SQL_TIMESTAMP_STRUCT *)Odp);
+            Odl = sizeof(SQL_TIMESTAMP_STRUCT);
+        }
+        else if (vt.isIntervalYM())
+        {
+            toIntervalYM(inputReader.getIntervalYMRef(j), *(SQL_INTERVAL_STRUCT *)Odp);
+            Odl = sizeof(SQL_INTERVAL_STRUCT);
+        }
+        else
+        {
+            toIntervalDS(inputReader.getIntervalRef(j), *(SQL_INTERVAL_STRUCT *)Odp);
+            Odl = sizeof(SQL_INTERVAL_STRUCT);
+        }
+    }
+
+    // C type DBLink::prepare binds a column of type Odt as
+    SQLSMALLINT bindCType(DBs dbt, SQLSMALLINT Odt)
+    {
+        switch (Odt)
+        {
+        case SQL_SMALLINT:
+        case SQL_INTEGER:
+        case SQL_TINYINT:
+        case SQL_BIGINT:
+            return (dbt == ORACLE) ? SQL_C_CHAR : SQL_C_SBIGINT;
+        case SQL_REAL:
+        case SQL_DOUBLE:
+        case SQL_FLOAT:
+            return SQL_C_DOUBLE;
+        case SQL_TYPE_TIME:
+            return SQL_C_TIME;
+        case SQL_TYPE_DATE:
+            return SQL_C_DATE;
+        case SQL_TYPE_TIMESTAMP:
+            return SQL_C_TIMESTAMP;
+        case SQL_BIT:
+            return SQL_C_BIT;
+        case SQL_BINARY:
+        case SQL_VARBINARY:
+        case SQL_LONGVARBINARY:
+            return SQL_C_BINARY;
+        case SQL_INTERVAL_YEAR_TO_MONTH:
+            return SQL_C_INTERVAL_YEAR_TO_MONTH;
+        case SQL_INTERVAL_DAY_TO_SECOND:
+            return SQL_C_INTERVAL_DAY_TO_SECOND;
+        default: // NUMERIC, DECIMAL and strings
+            return SQL_C_CHAR;
+        }
+    }
+
+    // Character types, whose SQL_DESC_OCTET_LENGTH is described and whose width can be sampled
+    bool isStringType(SQLSMALLINT Odt)
+    {
+        return Odt == SQL_CHAR || Odt == SQL_WCHAR || Odt == SQL_VARCHAR || Odt == SQL_WVARCHAR ||
+               Odt == SQL_LONGVARCHAR || Odt == SQL_WLONGVARCHAR;
+    }
+
+    // Binding of a result set column, as sized by DBLinkFactory::getReturnType and bound by DBLink::prepare
+    struct ColumnPlan
+    {
+        std::string outputType;          // Vertica output column type
+        const char *ctype = "";          // C type of the rowset buffer
+        SQLSMALLINT Octype = SQL_C_CHAR; // and its SQLBindCol value
+        size_t desz = 0;                 // buffer bytes per row, without the length/indicator
+        SQLULEN length = 0;              // declared length of string/binary columns, 0 for the other types
+        SQLULEN remote = 0;              // their remote length, capped to the maximum Vertica length
+        std::string note;                // truncation and binding warnings
+    };
+
+    // Caps a remote string/binary length as the factory does, then narrows it to width (declared by the
+    // schema or observed by width_sample, 0 if none), noting the truncation
+    SQLULEN capLength(SQLULEN Ors, SQLLEN Ool, SQLULEN limit, SQLULEN width, ColumnPlan &plan)
+    {
+        if (Ool > 0 && (SQLULEN)Ool > Ors)
+        {
+            Ors = (SQLULEN)Ool;
+        }
+        if (Ors > limit)
+        {
+            plan.note = "Remote length " + std::to_string(Ors) + " limited to " + std::to_string(limit) + " bytes, longer values are truncated";
+            Ors = limit;
+        }
+        plan.remote = Ors ? Ors : 1;
+        if (width > 0 && width < Ors)
+        {
+            plan.note += (plan.note.empty() ? "" : ". ") + std::string("Declared with the width ") + std::to_string(width) +
+                         " instead of " + std::to_string(Ors);
+            Ors = width;
+        }
+        plan.length = Ors ? Ors : 1;
+        return plan.length;
+    }
+
+    // Fills plan for a described column (Ool: SQL_DESC_OCTET_LENGTH of string columns, width: the declared width
+    // of string/binary columns or 0). False if the type is unsupported
+    bool planColumn(DBs dbt, SQLSMALLINT Odt, SQLULEN Ors, SQLLEN Ool, SQLSMALLINT Odd, SQLULEN width, ColumnPlan &plan)
+    {
+        plan.Octype = bindCType(dbt, Odt);
+        switch (Odt)
+        {
+        case SQL_SMALLINT:
+        case SQL_INTEGER:
+        case SQL_TINYINT:
+        case SQL_BIGINT:
+            plan.outputType = "INTEGER";
+            plan.ctype = (dbt == ORACLE) ? "SQL_C_CHAR" : "SQL_C_SBIGINT";
+            plan.desz = (dbt == ORACLE) ? (size_t)(Ors + 1) : sizeof(vint);
+            if (dbt == ORACLE)
+            {
+                plan.note = "Oracle integer fetched as text";
+            }
+            break;
+        case SQL_REAL:
+        case SQL_DOUBLE:
+        case SQL_FLOAT:
+            plan.outputType = "FLOAT";
+            plan.ctype = "SQL_C_DOUBLE";
+            plan.desz = sizeof(vfloat);
+            break;
+        case SQL_NUMERIC:
+        case SQL_DECIMAL:
+            plan.outputType = "NUMERIC(" + std::to_string(Ors) + "," + std::to_string(Odd) + ")";
+            plan.ctype = "SQL_C_CHAR";
+            plan.desz = MAX_NUMERIC_CHARLEN;
+            break;
+        case SQL_CHAR:
+        case SQL_WCHAR:
+            Ors = capLength(Ors, Ool, MAX_CHAR_LEN, width, plan);
+            plan.outputType = "CHAR(" + std::to_string(Ors) + ")";
+            plan.ctype = "SQL_C_CHAR";
+            plan.desz = (size_t)(Ors + 1);
+            break;
+        case SQL_VARCHAR:
+        case SQL_WVARCHAR:
+            Ors = capLength(Ors, Ool, MAX_CHAR_LEN, width, plan);
+            plan.outputType = "VARCHAR(" + std::to_string(Ors) + ")";
+            plan.ctype = "SQL_C_CHAR";
+            plan.desz = (size_t)(Ors + 1);
+            break;
+        case SQL_LONGVARCHAR:
+        case SQL_WLONGVARCHAR:
+            Ors = capLength(Ors, Ool, MAX_LONGCHAR_LEN, width, plan);
+            plan.outputType = "LONG VARCHAR(" + std::to_string(Ors) + ")";
+            plan.ctype = "SQL_C_CHAR";
+            plan.desz = (size_t)(Ors + 1);
+            break;
+        case SQL_TYPE_TIME:
+            plan.outputType = "TIME(" + std::to_string(Odd) + ")";
+            plan.ctype = "SQL_C_TIME";
+            plan.desz = sizeof(SQL_TIME_STRUCT);
+            break;
+        case SQL_TYPE_DATE:
+            plan.outputType = "DATE";
+            plan.ctype = "SQL_C_DATE";
+            plan.desz = sizeof(SQL_DATE_STRUCT);
+            break;
+        case SQL_TYPE_TIMESTAMP:
+            plan.outputType = "TIMESTAMP(" + std::to_string(Odd) + ")";
+            plan.ctype = "SQL_C_TIMESTAMP";
+            plan.desz = sizeof(SQL_TIMESTAMP_STRUCT);
+            break;
+        case SQL_BIT:
+            plan.outputType = "BOOLEAN";
+            plan.ctype = "SQL_C_BIT";
+            plan.desz = 1;
+            break;
+        case SQL_BINARY:
+        case SQL_VARBINARY:
+            Ors = capLength(Ors, 0, MAX_BINARY_LEN, width, plan);
+            plan.outputType = "BINARY(" + std::to_string(Ors) + ")";
+            plan.ctype = "SQL_C_BINARY";
+            plan.desz = (size_t)(Ors + 1);
+            break;
+        case SQL_LONGVARBINARY:
+            Ors = capLength(Ors, 0, MAX_LONGBINARY_LEN, width, plan);
+            plan.outputType = "LONG VARBINARY(" + std::to_string(Ors) + ")";
+            plan.ctype = "SQL_C_BINARY";
+            plan.desz = (size_t)(Ors + 1);
+            break;
+        case SQL_INTERVAL_YEAR_TO_MONTH:
+            plan.outputType = "INTERVAL YEAR TO MONTH";
+            plan.ctype = "SQL_C_INTERVAL_YEAR_TO_MONTH";
+            plan.desz = sizeof(SQL_INTERVAL_STRUCT);
+            break;
+        case SQL_INTERVAL_DAY_TO_SECOND:
+            plan.outputType = "INTERVAL DAY TO SECOND(" + std::to_string(Odd) + ")";
+            plan.ctype = "SQL_C_INTERVAL_DAY_TO_SECOND";
+            plan.desz = sizeof(SQL_INTERVAL_STRUCT);
+            break;
+        default:
+            plan.note = "Unsupported data type (ODBC type " + std::to_string(Odt) + "), the query fails";
+            return false;
+        }
+        return true;
+    }
+
+    // Statements returning the remote plan of query, empty where the dialect has no EXPLAIN
+    std::vector<std::string> getExplainQueries(DBs dbt, const std::string &query)
+    {
+        std::string q = query.substr(0, query.find_last_not_of(" \n\t\r;") + 1);
+        switch (dbt)
+        {
+        case POSTGRES:
+        case VERTICA:
+        case MYSQL:
+        case TERADATA:
+            return {"EXPLAIN " + q};
+        case ORACLE:
+            return {"EXPLAIN PLAN FOR " + q, "SELECT PLAN_TABLE_OUTPUT FROM TABLE(DBMS_XPLAN.DISPLAY())"};
+        case SQLSERVER:
+            return {"SET SHOWPLAN_TEXT ON", q, "SET SHOWPLAN_TEXT OFF"};
+        default:
+            return {};
+        }
+    }
+
     void getQuery(ServerInterface &srvInterface, std::string &query, bool &isSelect)
     {
         std::string queryString = "";
@@ -211,7 +908,7 @@ namespace DBLINK
         query = queryString;
     }
 
-    void clean(SQLHSTMT Ost, SQLHDBC Ocon, SQLHENV Oenv)
+    void clean(SQLHSTMT &Ost, SQLHDBC &Ocon, SQLHENV &Oenv)
     {
         if (Ost)
         {
@@ -220,6 +917,7 @@ namespace DBLINK
         }
         if (Ocon)
         {
+            (void)SQLEndTran(SQL_HANDLE_DBC, Ocon, SQL_ROLLBACK); // uncommitted target rows
             (void)SQLDisconnect(Ocon);
             (void)SQLFreeHandle(SQL_HANDLE_DBC, Ocon);
             Ocon = nullptr;
@@ -231,7 +929,7 @@ namespace DBLINK
         }
     }
 
-    void ex_err(SQLSMALLINT htype, SQLHANDLE Oh, int loc, const char *vtext, SQLHSTMT Ost, SQLHDBC Ocon, SQLHENV Oenv)
+    void ex_err(SQLSMALLINT htype, SQLHANDLE Oh, int loc, const char *vtext, SQLHSTMT &Ost, SQLHDBC &Ocon, SQLHENV &Oenv)
     {
         SQLCHAR Oerr_state[6];                 // ODBC Error State
         SQLINTEGER Oerr_native = 0;            // ODBC Error Native Code
@@ -260,498 +958,5060 @@ namespace DBLINK
         }
     }
 
-    class DBLink : public TransformFunction
+    // True if the last error of the statement is worth a reconnection (lost connection, timeout,
+    // serialization failure, Oracle snapshot too old). diag receives the error for the log
+    bool isTransientError(SQLHSTMT Ost, std::string &diag)
     {
-        SQLHENV Oenv = nullptr;
-        SQLHDBC Ocon = nullptr;
-        SQLHSTMT Ost = nullptr;
-
-        std::string cid_value = "";
-        std::string query = "";
-        bool is_select = false;
-        size_t rowset;
+        static const SQLINTEGER transientNative[] = {1555, 3113, 3114, 3135}; // ORA- codes
+        SQLCHAR Oerr_state[6];
+        SQLINTEGER Oerr_native = 0;
+        SQLCHAR Oerr_text[MAX_ODBC_ERROR_LEN];
+        SQLSMALLINT Oln = 0;
 
-        void setup(ServerInterface &srvInterface, const SizedColumnTypes &argTypes)
+        if (!SQL_SUCCEEDED(SQLGetDiagRec(SQL_HANDLE_STMT, Ost, 1, Oerr_state, &Oerr_native, Oerr_text,
+                                         (SQLSMALLINT)MAX_ODBC_ERROR_LEN, &Oln)))
+        { // no diagnostic: the connection is probably gone
+            diag = "no diagnostic record";
+            return true;
+        }
+        diag = std::string("State ") + (char *)Oerr_state + ". Native Code " + std::to_string((int)Oerr_native) + ". " + (char *)Oerr_text;
+        if (!strncmp((char *)Oerr_state, "08", 2) || !strcmp((char *)Oerr_state, "40001") ||
+            !strcmp((char *)Oerr_state, "HYT00") || !strcmp((char *)Oerr_state, "HYT01"))
         {
-            getCidValue(srvInterface, cid_value);
-            getQuery(srvInterface, query, is_select);
-
-            // Read/Set rowset Param:
-            ParamReader params = srvInterface.getParamReader();
-            if (params.containsParameter("rowset"))
-            {
-                vint rowset_param = params.getIntRef("rowset");
-                if (rowset_param < 1 || rowset_param > MAX_ROWSET)
-                {
-                    ex_err(0, 0, 203, "DBLink. Error rowset out of range", Ost, Ocon, Oenv);
-                }
-                else
-                {
-                    rowset = (size_t)rowset_param;
-                }
-            }
-            else
+            return true;
+        }
+        for (SQLINTEGER n : transientNative)
+        {
+            if (Oerr_native == n)
             {
-                rowset = DEF_ROWSET;
+                return true;
             }
         }
+        return false;
+    }
 
-        void cancel(ServerInterface &srvInterface)
+    // First diagnostic record of a handle, for the errors raised away from the UDx thread
+    std::string diagText(SQLSMALLINT htype, SQLHANDLE Oh)
+    {
+        SQLCHAR Oerr_state[6];
+        SQLINTEGER Oerr_native = 0;
+        SQLCHAR Oerr_text[MAX_ODBC_ERROR_LEN];
+        SQLSMALLINT Oln = 0;
+
+        if (!Oh || !SQL_SUCCEEDED(SQLGetDiagRec(htype, Oh, 1, Oerr_state, &Oerr_native, Oerr_text,
+                                                (SQLSMALLINT)MAX_ODBC_ERROR_LEN, &Oln)))
         {
-            SQLRETURN Oret = 0;
-            if (Ost)
+            return "Unable to display ODBC error message";
+        }
+        return std::string("State ") + (char *)Oerr_state + ". Native Code " + std::to_string((int)Oerr_native) + ". Error text: " + (char *)Oerr_text;
+    }
+
+    // ODBC connection string of the CID pointing at one remote Vertica node, with load balancing off
+    std::string nodeConnectString(const std::string &cid_value, const std::string &address)
+    {
+        static const char *dropped[] = {"servername", "server", "host", "backupservernode", "connectionloadbalance"};
+        std::stringstream ss(cid_value);
+        std::string token;
+        std::string connect = "";
+
+        while (std::getline(ss, token, ';'))
+        {
+            std::string key = token.substr(0, token.find('='));
+            key.erase(0, key.find_first_not_of(" \t"));
+            key.erase(key.find_last_not_of(" \t") + 1);
+            std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+            if (key.empty() || std::find_if(std::begin(dropped), std::end(dropped), [&key](const char *d) { return key == d; }) != std::end(dropped))
             {
-                if (!SQL_SUCCEEDED(Oret = SQLCancel(Ost)))
-                {
-                    ex_err(SQL_HANDLE_STMT, Ost, 301, "Error canceling SQL statement", Ost, Ocon, Oenv);
-                }
+                continue;
             }
-            clean(Ost, Ocon, Oenv);
+            connect += token + ";";
         }
+        return connect + "Servername=" + address + ";ConnectionLoadBalance=0";
+    }
 
-        void destroy(ServerInterface &srvInterface, const SizedColumnTypes &argTypes)
+    // Restricts query to the segmentation hash range [lower, upper) of a node, an empty bound leaving the range open,
+    // and reads it at epoch so that the queries of all the nodes read the same snapshot
+    std::string segmentQuery(const std::string &query, const std::string &expr, const std::string &lower, const std::string &upper,
+                             const std::string &epoch)
+    {
+        std::string q = query.substr(0, query.find_last_not_of(" \n\t\r;") + 1);
+        std::string where = "";
+
+        if (!lower.empty())
         {
-#ifdef DBLINK_DEBUG
-            srvInterface.log("DEBUG DBLink clean called in DBLink::destory");
-#endif
-            clean(Ost, Ocon, Oenv);
+            where = expr + " >= " + lower;
         }
-
-        void processPartition(ServerInterface &srvInterface,
-                              PartitionReader &inputReader,
-                              PartitionWriter &outputWriter)
+        if (!upper.empty())
         {
-            SQLCHAR Obuff[64];
-            DBs dbt;
+            where += (where.empty() ? "" : " AND ") + expr + " < " + upper;
+        }
+        return "AT EPOCH " + epoch + " " + (where.empty() ? q : "SELECT * FROM (" + q + ") dblink_segment WHERE " + where);
+    }
 
-            SQLSMALLINT Onamel = 0;
+    // Quotes value as a SQL string literal
+    std::string sqlLiteral(const std::string &value)
+    {
+        std::string quoted = "'";
+        for (char c : value)
+        {
+            quoted += (c == '\'') ? "''" : std::string(1, c);
+        }
+        return quoted + "'";
+    }
+
+    // Removes the table qualifiers of a projection segment_expression ("hash(orders.id)" -> "hash(id)")
+    std::string unqualify(const std::string &expr, const std::string &table)
+    {
+        std::string lexpr = expr;
+        std::string prefix = table + ".";
+        std::string result = "";
+
+        std::transform(lexpr.begin(), lexpr.end(), lexpr.begin(), ::tolower);
+        std::transform(prefix.begin(), prefix.end(), prefix.begin(), ::tolower);
+        for (size_t i = 0; i < expr.size();)
+        {
+            if (!lexpr.compare(i, prefix.size(), prefix) && (i == 0 || !(isalnum((unsigned char)expr[i - 1]) || expr[i - 1] == '_')))
+            {
+                i += prefix.size();
+                continue;
+            }
+            result += expr[i++];
+        }
+        return result;
+    }
+
+    // Lower case names of the columns a segment_expression reads ("hash(id, \"Name\")" -> id, name). Function names,
+    // literals and cast types are skipped
+    std::vector<std::string> exprColumns(const std::string &expr)
+    {
+        std::vector<std::string> cols;
+        bool cast = false;
+
+        for (size_t i = 0; i < expr.size();)
+        {
+            char c = expr[i];
+            if (c == '\'' || c == '"')
+            {
+                size_t end = expr.find(c, i + 1);
+                end = (end == std::string::npos) ? expr.size() : end;
+                if (c == '"' && !cast)
+                {
+                    cols.push_back(expr.substr(i + 1, end - i - 1));
+                }
+                cast = false;
+                i = end + 1;
+            }
+            else if (isalpha((unsigned char)c) || c == '_' || isdigit((unsigned char)c))
+            {
+                size_t end = i;
+                while (end < expr.size() && (isalnum((unsigned char)expr[end]) || expr[end] == '_' || expr[end] == '$'))
+                {
+                    end++;
+                }
+                size_t next = expr.find_first_not_of(" \t\r\n", end);
+                if (!isdigit((unsigned char)c) && !cast && (next == std::string::npos || expr[next] != '('))
+                {
+                    cols.push_back(expr.substr(i, end - i));
+                }
+                cast = false;
+                i = end;
+            }
+            else
+            {
+                cast = (c == ':' && i > 0 && expr[i - 1] == ':');
+                i++;
+            }
+        }
+        for (auto &col : cols)
+        {
+            std::transform(col.begin(), col.end(), col.begin(), ::tolower);
+        }
+        return cols;
+    }
+
+#ifdef DBLINK_LIBPQ
+    enum PgCols
+    {
+        PG_UNSUPPORTED = 0,
+        PG_INT,
+        PG_FLOAT4,
+        PG_FLOAT8,
+        PG_NUMERIC,
+        PG_BOOL,
+        PG_BYTES,
+        PG_DATE,
+        PG_TIME,
+        PG_TIMESTAMP,
+        PG_INTERVAL_YM,
+        PG_INTERVAL_DS
+    };
+
+    static const char PGCOPY_SIGNATURE[] = "PGCOPY\n\377\r\n"; // COPY BINARY header signature (11 bytes incl. '\0')
+
+    inline int16_t pgInt16(const char *p)
+    {
+        uint16_t v;
+        memcpy(&v, p, sizeof(v));
+        return (int16_t)be16toh(v);
+    }
+
+    inline int32_t pgInt32(const char *p)
+    {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return (int32_t)be32toh(v);
+    }
+
+    inline int64_t pgInt64(const char *p)
+    {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        return (int64_t)be64toh(v);
+    }
+
+    inline void pgPutInt16(std::string &buf, int16_t v)
+    {
+        uint16_t b = htobe16((uint16_t)v);
+        buf.append((const char *)&b, sizeof(b));
+    }
+
+    inline void pgPutInt32(std::string &buf, int32_t v)
+    {
+        uint32_t b = htobe32((uint32_t)v);
+        buf.append((const char *)&b, sizeof(b));
+    }
+
+    inline void pgPutInt64(std::string &buf, int64_t v)
+    {
+        uint64_t b = htobe64((uint64_t)v);
+        buf.append((const char *)&b, sizeof(b));
+    }
+
+    std::string pgQuote(const std::string &value)
+    {
+        std::string quoted = "'";
+        for (char c : value)
+        {
+            if (c == '\'' || c == '\\')
+            {
+                quoted += '\\';
+            }
+            quoted += c;
+        }
+        return quoted + "'";
+    }
+
+    // Builds a libpq conninfo string from the ODBC connection string, resolving DSN entries through odbc.ini
+    std::string getPgConninfo(const std::string &odbcConnect)
+    {
+        static const char *keys[][2] = {
+            {"servername", "host"}, {"server", "host"}, {"host", "host"}, {"port", "port"},
+            {"database", "dbname"}, {"dbname", "dbname"}, {"uid", "user"}, {"username", "user"},
+            {"user", "user"}, {"pwd", "password"}, {"password", "password"}, {"sslmode", "sslmode"}};
+        std::map<std::string, std::string> pgopts;
+        std::stringstream ss(odbcConnect);
+        std::string token;
+        std::string dsn = "";
+
+        while (std::getline(ss, token, ';'))
+        {
+            size_t pos = token.find('=');
+            if (pos == std::string::npos)
+            {
+                continue;
+            }
+            std::string key = token.substr(0, pos);
+            key.erase(0, key.find_first_not_of(" \t"));
+            key.erase(key.find_last_not_of(" \t") + 1);
+            std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+            if (key == "dsn")
+            {
+                dsn = token.substr(pos + 1);
+                continue;
+            }
+            for (auto &k : keys)
+            {
+                if (key == k[0])
+                {
+                    pgopts[k[1]] = token.substr(pos + 1);
+                }
+            }
+        }
+
+        if (!dsn.empty())
+        { // Connection string values take precedence over the DSN definition
+            char value[MAX_DSN_VALUE_LEN];
+            for (auto &k : keys)
+            {
+                if (pgopts.count(k[1]) == 0 &&
+                    SQLGetPrivateProfileString(dsn.c_str(), k[0], "", value, (int)sizeof(value), "odbc.ini") > 0)
+                {
+                    pgopts[k[1]] = value;
+                }
+            }
+        }
+
+        std::string conninfo = "";
+        for (auto &o : pgopts)
+        {
+            conninfo += o.first + "=" + pgQuote(o.second) + " ";
+        }
+        return conninfo;
+    }
+
+    // Maps a remote column (PostgreSQL type OID) onto the output column type produced by getReturnType
+    PgCols getPgCol(Oid oid, const VerticaType &vt)
+    {
+        switch (oid)
+        {
+        case 20: // int8
+        case 21: // int2
+        case 23: // int4
+        case 26: // oid
+            return vt.isInt() ? PG_INT : PG_UNSUPPORTED;
+        case 700: // float4
+            return vt.isFloat() ? PG_FLOAT4 : PG_UNSUPPORTED;
+        case 701: // float8
+            return vt.isFloat() ? PG_FLOAT8 : PG_UNSUPPORTED;
+        case 1700: // numeric
+            return vt.isNumeric() ? PG_NUMERIC : PG_UNSUPPORTED;
+        case 16: // bool
+            return vt.isBool() ? PG_BOOL : PG_UNSUPPORTED;
+        case 17:   // bytea
+        case 18:   // char
+        case 19:   // name
+        case 25:   // text
+        case 1042: // bpchar
+        case 1043: // varchar
+            return (vt.isChar() || vt.isVarchar() || vt.isLongVarchar() ||
+                    vt.isBinary() || vt.isVarbinary() || vt.isLongVarbinary())
+                       ? PG_BYTES
+                       : PG_UNSUPPORTED;
+        case 1082: // date
+            return vt.isDate() ? PG_DATE : PG_UNSUPPORTED;
+        case 1083: // time
+            return vt.isTime() ? PG_TIME : PG_UNSUPPORTED;
+        case 1114: // timestamp
+            return vt.isTimestamp() ? PG_TIMESTAMP : PG_UNSUPPORTED;
+        case 1184: // timestamptz, microseconds from 2000-01-01 UTC in both databases
+            return vt.isTimestampTz() ? PG_TIMESTAMP : PG_UNSUPPORTED;
+        case 1186: // interval
+            return vt.isIntervalYM() ? PG_INTERVAL_YM : (vt.isInterval() ? PG_INTERVAL_DS : PG_UNSUPPORTED);
+        default:
+            return PG_UNSUPPORTED;
+        }
+    }
+
+    // Converts a binary NUMERIC (base 10000 digits) to its text representation
+    bool pgNumericToString(const char *p, int32_t len, std::string &out)
+    {
+        if (len < 8)
+        {
+            return false;
+        }
+        int16_t ndigits = pgInt16(p);
+        int16_t weight = pgInt16(p + 2);
+        uint16_t sign = (uint16_t)pgInt16(p + 4);
+        int16_t dscale = pgInt16(p + 6);
+        char group[8];
+
+        if ((sign != 0x0000 && sign != 0x4000) || len < 8 + ndigits * 2)
+        { // NaN, infinity or malformed
+            return false;
+        }
+        out.clear();
+        if (sign == 0x4000)
+        {
+            out += '-';
+        }
+        if (weight < 0)
+        {
+            out += '0';
+        }
+        for (int i = 0; i <= weight; i++)
+        {
+            int16_t d = (i < ndigits) ? pgInt16(p + 8 + i * 2) : 0;
+            snprintf(group, sizeof(group), (i == 0) ? "%d" : "%04d", d);
+            out += group;
+        }
+        if (dscale > 0)
+        {
+            size_t dot = out.size();
+            out += '.';
+            for (int i = weight + 1; (int)(out.size() - dot - 1) < dscale; i++)
+            {
+                int16_t d = (i >= 0 && i < ndigits) ? pgInt16(p + 8 + i * 2) : 0;
+                snprintf(group, sizeof(group), "%04d", d);
+                out += group;
+            }
+            out.resize(dot + 1 + dscale);
+        }
+        return true;
+    }
+
+    // Converts a NUMERIC text ([-]digits[.digits]) to its binary (base 10000 digits) representation
+    bool pgNumericFromString(const char *text, std::string &out)
+    {
+        bool neg = (*text == '-');
+        if (*text == '-' || *text == '+')
+        {
+            text++;
+        }
+        const char *dot = strchr(text, '.');
+        std::string ipart = dot ? std::string(text, dot - text) : std::string(text);
+        std::string fpart = dot ? std::string(dot + 1) : "";
+        if (ipart.empty() && fpart.empty())
+        {
+            return false;
+        }
+        for (char c : ipart + fpart)
+        {
+            if (c < '0' || c > '9')
+            {
+                return false;
+            }
+        }
+
+        // Groups of 4 digits aligned on the decimal point:
+        std::string padded = std::string((4 - ipart.size() % 4) % 4, '0') + ipart;
+        int16_t weight = (int16_t)(padded.size() / 4) - 1;
+        padded += fpart + std::string((4 - fpart.size() % 4) % 4, '0');
+        std::vector<int16_t> digits;
+        for (size_t i = 0; i < padded.size(); i += 4)
+        {
+            digits.push_back((int16_t)atoi(padded.substr(i, 4).c_str()));
+        }
+        size_t first = 0;
+        while (first < digits.size() && digits[first] == 0)
+        {
+            first++;
+            weight--;
+        }
+        while (digits.size() > first && digits.back() == 0)
+        {
+            digits.pop_back();
+        }
+        if (first == digits.size())
+        { // zero
+            weight = 0;
+            neg = false;
+        }
+
+        out.clear();
+        pgPutInt16(out, (int16_t)(digits.size() - first));
+        pgPutInt16(out, weight);
+        pgPutInt16(out, neg ? (int16_t)0x4000 : 0);
+        pgPutInt16(out, (int16_t)fpart.size());
+        for (size_t i = first; i < digits.size(); i++)
+        {
+            pgPutInt16(out, digits[i]);
+        }
+        return true;
+    }
+
+    void pg_err(PGconn *&Opg, int loc, const char *vtext)
+    {
+        std::string msg = (Opg == nullptr) ? "" : PQerrorMessage(Opg);
+        msg.erase(msg.find_last_not_of(" \n\r\t") + 1);
+        if (Opg)
+        {
+            PQfinish(Opg);
+            Opg = nullptr;
+        }
+        vt_report_error(loc, "DBLINK. %s. Error text: %s", vtext, msg.c_str());
+    }
+#endif
+
+    struct GovernorParams
+    {
+        int max_connections = 0; // 0: unlimited
+        int max_queries = 0;     // 0: unlimited
+        int priority = DEF_PRIORITY;
+        int timeout = DEF_QUEUE_TIMEOUT;
+    };
+
+    void getGovernorParams(ServerInterface &srvInterface, GovernorParams &gov)
+    {
+        ParamReader params = srvInterface.getParamReader();
+        if (params.containsParameter("max_connections"))
+        {
+            gov.max_connections = (int)params.getIntRef("max_connections");
+        }
+        if (params.containsParameter("max_queries"))
+        {
+            gov.max_queries = (int)params.getIntRef("max_queries");
+        }
+        if (params.containsParameter("priority"))
+        {
+            gov.priority = (int)std::max((vint)0, std::min((vint)MAX_PRIORITY, params.getIntRef("priority")));
+        }
+        if (params.containsParameter("queue_timeout"))
+        {
+            gov.timeout = (int)params.getIntRef("queue_timeout");
+        }
+    }
+
+    // FNV-1a of s, as a file name
+    std::string hashKey(const std::string &s)
+    {
+        uint64_t h = 14695981039346656037ULL;
+        char buf[17];
+        for (unsigned char c : s)
+        {
+            h = (h ^ c) * 1099511628211ULL;
+        }
+        snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)h);
+        return buf;
+    }
+
+    // Creates name in DBLINK_GOVERNOR_DIR already flock()ed: it is locked under a name no scan looks at,
+    // then renamed, so that no scan finds it unlocked and removes it as a dead process' file. -1 on error
+    int createLocked(const std::string &name)
+    {
+        std::string tmp = std::string(DBLINK_GOVERNOR_DIR) + "/.new." + name;
+        std::string path = std::string(DBLINK_GOVERNOR_DIR) + "/" + name;
+        int fd = open(tmp.c_str(), O_CREAT | O_EXCL | O_RDWR, 0666);
+
+        if (fd >= 0 && (flock(fd, LOCK_EX) != 0 || rename(tmp.c_str(), path.c_str()) != 0))
+        {
+            (void)unlink(tmp.c_str());
+            close(fd);
+            fd = -1;
+        }
+        return fd;
+    }
+
+    // One of the node wide slots limiting the sessions (or running queries) opened on a remote database
+    // by all the UDx processes. Slots are flock()ed files, so the kernel frees them if a process dies.
+    // Waiters queue in priority then arrival order through flock()ed waiter files, polled with a backoff
+    // so that a long queue does not keep every waiter scanning the directory
+    class GovernorSlot
+    {
+        int fd = -1;
+
+        // True if no live waiter named with prefix is queued before wname. Removes dead waiters
+        static bool firstInQueue(const std::string &prefix, const std::string &wname)
+        {
+            DIR *dir = opendir(DBLINK_GOVERNOR_DIR);
+            struct dirent *de;
+            bool first = true;
+
+            if (dir == nullptr)
+            {
+                return true;
+            }
+            while (first && (de = readdir(dir)) != nullptr)
+            {
+                std::string name = de->d_name;
+                if (name.compare(0, prefix.size(), prefix) || name >= wname)
+                {
+                    continue;
+                }
+                std::string path = std::string(DBLINK_GOVERNOR_DIR) + "/" + name;
+                int wfd = open(path.c_str(), O_RDWR);
+                if (wfd < 0)
+                {
+                    continue;
+                }
+                if (flock(wfd, LOCK_EX | LOCK_NB) == 0)
+                { // its process is gone
+                    (void)unlink(path.c_str());
+                }
+                else
+                {
+                    first = false;
+                }
+                close(wfd);
+            }
+            closedir(dir);
+            return first;
+        }
+
+    public:
+        ~GovernorSlot()
+        {
+            release();
+        }
+
+        // Waits for one of the max slots of kind for the CID, giving up if canceled() turns true.
+        // Returns the milliseconds spent in the queue
+        long acquire(const std::string &cid_value, const char *kind, int max, int priority, int timeout,
+                     const std::function<bool()> &canceled = nullptr)
+        {
+            if (fd >= 0 || max <= 0)
+            {
+                return 0;
+            }
+            (void)mkdir(DBLINK_GOVERNOR_DIR, 0777);
+
+            std::string base = hashKey(cid_value) + "." + kind;
+            std::string prefix = base + ".w";
+            char wname[256];
+            auto start = std::chrono::steady_clock::now();
+            long long arrival = (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                    std::chrono::system_clock::now().time_since_epoch())
+                                    .count();
+            snprintf(wname, sizeof(wname), "%s%03d.%020lld.%d.%p", prefix.c_str(), MAX_PRIORITY - priority, arrival, (int)getpid(), (void *)this);
+            std::string wpath = std::string(DBLINK_GOVERNOR_DIR) + "/" + wname;
+            int wfd = createLocked(wname);
+            if (wfd < 0)
+            {
+                vt_report_error(209, "DBLINK. Error creating governor queue file <%s>", wpath.c_str());
+            }
+
+            long waited = 0;
+            useconds_t poll = GOVERNOR_POLL_US;
+            while (fd < 0)
+            {
+                if (firstInQueue(prefix, wname))
+                {
+                    for (int k = 0; k < max && fd < 0; k++)
+                    {
+                        std::string spath = std::string(DBLINK_GOVERNOR_DIR) + "/" + base + "." + std::to_string(k);
+                        int sfd = open(spath.c_str(), O_CREAT | O_RDWR, 0666);
+                        if (sfd >= 0 && flock(sfd, LOCK_EX | LOCK_NB) == 0)
+                        {
+                            fd = sfd;
+                        }
+                        else if (sfd >= 0)
+                        {
+                            close(sfd);
+                        }
+                    }
+                }
+                waited = (long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+                if (fd < 0 && waited > timeout * 1000L)
+                {
+                    (void)unlink(wpath.c_str());
+                    close(wfd);
+                    vt_report_error(209, "DBLINK. Timed out after %d seconds waiting for a %s slot (%d in use)", timeout, kind, max);
+                }
+                if (fd < 0 && canceled && canceled())
+                {
+                    (void)unlink(wpath.c_str());
+                    close(wfd);
+                    vt_report_error(209, "DBLINK. Canceled while waiting for a %s slot", kind);
+                }
+                if (fd < 0)
+                {
+                    usleep(poll);
+                    poll = std::min(poll * 2, (useconds_t)GOVERNOR_MAX_POLL_US);
+                }
+            }
+            (void)unlink(wpath.c_str());
+            close(wfd);
+            return waited;
+        }
+
+        void release()
+        {
+            if (fd >= 0)
+            {
+                close(fd); // drops the flock
+                fd = -1;
+            }
+        }
+
+        // Takes over the slot held by other
+        void take(GovernorSlot &other)
+        {
+            release();
+            fd = other.fd;
+            other.fd = -1;
+        }
+    };
+
+    // Identifies the CID of a query: its connection string, or all the members of a replica group, since the
+    // factory and the instances may be routed to different ones
+    std::string cidKey(std::vector<std::string> members, const std::string &cid_value)
+    {
+        std::string k = "";
+        if (members.size() < 2)
+        {
+            members.assign(1, cid_value);
+        }
+        std::sort(members.begin(), members.end());
+        for (auto &m : members)
+        {
+            k += m + "\n";
+        }
+        return k;
+    }
+
+    // Observed widths of the string columns of a query, cached per CID and query as "<column> <width>" lines in the
+    // width_cache directory. Columns not listed are declared with their remote width
+    std::string widthCacheFile(ServerInterface &srvInterface, const std::vector<std::string> &replicas, const std::string &cid_value,
+                               const std::string &query)
+    {
+        ParamReader params = srvInterface.getParamReader();
+        std::string dir = params.containsParameter("width_cache") ? params.getStringRef("width_cache").str() : DBLINK_WIDTHS_DIR;
+        return dir + "/" + hashKey(cidKey(replicas, cid_value) + query);
+    }
+
+    // Reads the cached widths. False if there is no cache or it is older than max_age seconds
+    bool loadWidths(const std::string &file, std::map<size_t, SQLULEN> &widths, time_t max_age = WIDTH_CACHE_SECONDS)
+    {
+        struct stat st;
+        size_t j = 0;
+        SQLULEN w = 0;
+
+        if (stat(file.c_str(), &st) != 0 || time(NULL) - st.st_mtime > max_age)
+        {
+            return false;
+        }
+        std::ifstream in(file);
+        while (in >> j >> w)
+        {
+            widths[j] = w;
+        }
+        return true;
+    }
+
+    // Write and rename, so that concurrent plannings never read a truncated cache. The temporary file is unique
+    // across the nodes sharing the directory
+    void saveWidths(const std::string &file, const std::map<size_t, SQLULEN> &widths)
+    {
+        char host[256] = "";
+        (void)gethostname(host, sizeof(host) - 1);
+        (void)mkdir(file.substr(0, file.rfind('/')).c_str(), 0777);
+        std::string tmp = file + "." + host + "." + std::to_string(getpid()) + "." +
+                          std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        std::ofstream out(tmp, std::ios::trunc);
+        for (auto &w : widths)
+        {
+            out << w.first << " " << w.second << std::endl;
+        }
+        out.close();
+        if (out.fail() || rename(tmp.c_str(), file.c_str()) != 0)
+        {
+            (void)unlink(tmp.c_str());
+        }
+    }
+
+    // Query running on a replica: an flocked file of DBLINK_GOVERNOR_DIR counted by outstandingQueries().
+    // The files left by crashed processes are not locked anymore, and not counted
+    class InflightMark
+    {
+        int fd = -1;
+        std::string path;
+
+    public:
+        ~InflightMark()
+        {
+            release();
+        }
+
+        void acquire(const std::string &cid_value)
+        {
+            char name[256];
+            if (fd >= 0)
+            {
+                return;
+            }
+            (void)mkdir(DBLINK_GOVERNOR_DIR, 0777);
+            snprintf(name, sizeof(name), "%s.inflight.%d.%p", hashKey(cid_value).c_str(), (int)getpid(), (void *)this);
+            path = std::string(DBLINK_GOVERNOR_DIR) + "/" + name;
+            fd = createLocked(name);
+        }
+
+        void release()
+        {
+            if (fd >= 0)
+            {
+                (void)unlink(path.c_str());
+                close(fd);
+                fd = -1;
+            }
+        }
+    };
+
+    // Queries running on the connection string on this node, removing the marks left by crashed processes
+    int outstandingQueries(const std::string &cid_value)
+    {
+        std::string prefix = hashKey(cid_value) + ".inflight.";
+        DIR *dir = opendir(DBLINK_GOVERNOR_DIR);
+        struct dirent *de;
+        int count = 0;
+
+        if (!dir)
+        {
+            return 0;
+        }
+        while ((de = readdir(dir)) != nullptr)
+        {
+            if (strncmp(de->d_name, prefix.c_str(), prefix.size()))
+            {
+                continue;
+            }
+            std::string path = std::string(DBLINK_GOVERNOR_DIR) + "/" + de->d_name;
+            int fd = open(path.c_str(), O_RDWR);
+            if (fd < 0)
+            {
+                continue;
+            }
+            if (flock(fd, LOCK_EX | LOCK_NB) == 0)
+            {
+                (void)unlink(path.c_str());
+            }
+            else
+            {
+                count++;
+            }
+            close(fd);
+        }
+        closedir(dir);
+        return count;
+    }
+
+    // Orders the members of a replica group by outstanding queries, the least loaded first (ties in random order)
+    void routeReplicas(std::vector<std::string> &replicas)
+    {
+        std::vector<std::pair<int, std::string>> load;
+        size_t first = (size_t)std::chrono::steady_clock::now().time_since_epoch().count() % replicas.size();
+
+        for (size_t k = 0; k < replicas.size(); k++)
+        {
+            const std::string &r = replicas[(first + k) % replicas.size()];
+            load.push_back({outstandingQueries(r), r});
+        }
+        std::stable_sort(load.begin(), load.end(), [](const std::pair<int, std::string> &a, const std::pair<int, std::string> &b) { return a.first < b.first; });
+        for (size_t k = 0; k < load.size(); k++)
+        {
+            replicas[k] = load[k].second;
+        }
+    }
+
+    // First rowset latencies (ms) of the recent queries of a replica group, HEDGE_HISTORY at most
+    std::vector<long> loadLatencies(const std::string &file)
+    {
+        std::vector<long> latencies;
+        std::ifstream in(file);
+        long ms;
+        while (in >> ms)
+        {
+            latencies.push_back(ms);
+        }
+        return latencies;
+    }
+
+    // Appends a latency under an flock() of file.lock, so that the queries completing together keep all their samples
+    void recordLatency(const std::string &file, long ms)
+    {
+        (void)mkdir(DBLINK_GOVERNOR_DIR, 0777);
+        int lfd = open((file + ".lock").c_str(), O_CREAT | O_RDWR, 0666);
+        if (lfd < 0 || flock(lfd, LOCK_EX) != 0)
+        {
+            if (lfd >= 0)
+            {
+                close(lfd);
+            }
+            return;
+        }
+        std::vector<long> latencies = loadLatencies(file);
+        latencies.push_back(ms);
+        size_t from = latencies.size() > HEDGE_HISTORY ? latencies.size() - HEDGE_HISTORY : 0;
+        std::string tmp = file + "." + std::to_string(getpid());
+        std::ofstream out(tmp, std::ios::trunc);
+        for (size_t k = from; k < latencies.size(); k++)
+        {
+            out << latencies[k] << std::endl;
+        }
+        out.close();
+        if (out.fail() || rename(tmp.c_str(), file.c_str()) != 0)
+        {
+            (void)unlink(tmp.c_str());
+        }
+        close(lfd); // releases the lock
+    }
+
+    // Delay before hedging a query: the pct percentile of the recent latencies. -1 until HEDGE_MIN_SAMPLES were recorded
+    long hedgeDelay(const std::string &file, int pct)
+    {
+        std::vector<long> latencies = loadLatencies(file);
+        if (latencies.size() < HEDGE_MIN_SAMPLES)
+        {
+            return -1;
+        }
+        size_t k = std::min(latencies.size() - 1, latencies.size() * (size_t)pct / 100);
+        std::nth_element(latencies.begin(), latencies.begin() + k, latencies.end());
+        return std::max(latencies[k], (long)HEDGE_MIN_DELAY_MS);
+    }
+
+    enum WatermarkKinds
+    {
+        WM_NONE = 0,
+        WM_INT,
+        WM_NUMERIC,
+        WM_TIMESTAMP,
+        WM_DATE,
+        WM_CHAR
+    };
+
+    static const char *WM_KIND_NAMES[] = {"NONE", "INT", "NUMERIC", "TIMESTAMP", "DATE", "CHAR"};
+
+    // High-water mark of an incremental extraction, read from a state file holding "<KIND> <value>".
+    // Also used as the last emitted key of a resumable extraction, saved as its checkpoint
+    class Watermark
+    {
+        WatermarkKinds kind = WM_NONE; // kind of the mark read from the state file (bound as predicate)
+        SQLBIGINT bind_int = 0;
+        SQL_TIMESTAMP_STRUCT bind_ts;
+        int bind_digits = 0; // fractional seconds digits of bind_ts
+        SQL_DATE_STRUCT bind_date;
+        std::string bind_str = "";
+        SQLLEN bind_ind = 0;
+
+        WatermarkKinds new_kind = WM_NONE; // kind of the highest value fetched so far
+        SQLBIGINT new_int = 0;
+        SQL_TIMESTAMP_STRUCT new_ts;
+        SQL_DATE_STRUCT new_date;
+        std::string new_str = "";
+
+        static bool tsLess(const SQL_TIMESTAMP_STRUCT &a, const SQL_TIMESTAMP_STRUCT &b)
+        {
+            if (a.year != b.year)
+                return a.year < b.year;
+            if (a.month != b.month)
+                return a.month < b.month;
+            if (a.day != b.day)
+                return a.day < b.day;
+            if (a.hour != b.hour)
+                return a.hour < b.hour;
+            if (a.minute != b.minute)
+                return a.minute < b.minute;
+            if (a.second != b.second)
+                return a.second < b.second;
+            return a.fraction < b.fraction;
+        }
+
+        // Splits a decimal number as text into its sign, integer digits without leading zeros
+        // and fraction digits without trailing zeros
+        static void splitDecimal(const char *v, bool &neg, std::string &ip, std::string &fp)
+        {
+            neg = (*v == '-');
+            if (*v == '-' || *v == '+')
+            {
+                v++;
+            }
+            while (*v == '0')
+            {
+                v++;
+            }
+            const char *dot = strchr(v, '.');
+            ip.assign(v, dot ? (size_t)(dot - v) : strlen(v));
+            fp = dot ? dot + 1 : "";
+            fp.erase(fp.find_last_not_of('0') + 1);
+            neg = neg && !(ip.empty() && fp.empty()); // -0
+        }
+
+        // Compares two decimal numbers as text, exactly. Exponent notation is compared as long double
+        static int decimalCompare(const char *a, const char *b)
+        {
+            bool na, nb;
+            std::string ia, fa, ib, fb;
+            int c;
+
+            if (strpbrk(a, "eE") || strpbrk(b, "eE"))
+            {
+                long double x = strtold(a, NULL), y = strtold(b, NULL);
+                return (x > y) - (x < y);
+            }
+            splitDecimal(a, na, ia, fa);
+            splitDecimal(b, nb, ib, fb);
+            if (na != nb)
+            {
+                return na ? -1 : 1;
+            }
+            if (ia.size() != ib.size())
+            {
+                c = (ia.size() < ib.size()) ? -1 : 1;
+            }
+            else if ((c = ia.compare(ib)) == 0)
+            {
+                c = fa.compare(fb);
+            }
+            c = (c > 0) - (c < 0);
+            return na ? -c : c;
+        }
+
+    public:
+        std::string column = "";
+        std::string file = "";
+        bool ordered = false; // rows come ordered by column: track the last value instead of the highest
+        vint rows = 0;        // rows emitted, saved along with the mark when set
+        int digits = 6;       // fractional seconds digits of a timestamp column
+
+        Watermark()
+        {
+            memset(&bind_ts, 0, sizeof(bind_ts));
+            memset(&bind_date, 0, sizeof(bind_date));
+            memset(&new_ts, 0, sizeof(new_ts));
+            memset(&new_date, 0, sizeof(new_date));
+        }
+
+        bool enabled() const
+        {
+            return !column.empty();
+        }
+
+        bool hasMark() const
+        {
+            return kind != WM_NONE;
+        }
+
+        // Reads the last mark. A missing or empty state file means a full extraction
+        void load()
+        {
+            std::ifstream state(file);
+            std::string skind = "";
+            std::string value = "";
+
+            if (!state.is_open() || !(state >> skind) || !std::getline(state >> std::ws, value))
+            {
+                return;
+            }
+            for (int k = WM_INT; k <= WM_CHAR; k++)
+            {
+                if (skind == WM_KIND_NAMES[k])
+                {
+                    kind = (WatermarkKinds)k;
+                }
+            }
+            switch (kind)
+            {
+            case WM_INT:
+                bind_int = (SQLBIGINT)strtoll(value.c_str(), NULL, 10);
+                break;
+            case WM_TIMESTAMP:
+            {
+                int y = 0, n = 0;
+                unsigned mo = 0, d = 0, h = 0, mi = 0, sec = 0, f = 0;
+                if (sscanf(value.c_str(), "%d-%u-%u %u:%u:%u%n", &y, &mo, &d, &h, &mi, &sec, &n) < 6)
+                {
+                    vt_report_error(207, "DBLINK. Invalid watermark <%s> in <%s>", value.c_str(), file.c_str());
+                }
+                // Bound with the digits written, so the mark is compared with the precision it was fetched with
+                bind_digits = 0;
+                if (value[n] == '.')
+                {
+                    for (const char *p = value.c_str() + n + 1; isdigit((unsigned char)*p) && bind_digits < 9; p++, bind_digits++)
+                    {
+                        f = f * 10 + (unsigned)(*p - '0');
+                    }
+                }
+                for (int k = bind_digits; k < 9; k++)
+                {
+                    f *= 10;
+                }
+                bind_ts = {(SQLSMALLINT)y, (SQLUSMALLINT)mo, (SQLUSMALLINT)d, (SQLUSMALLINT)h, (SQLUSMALLINT)mi, (SQLUSMALLINT)sec, (SQLUINTEGER)f};
+                break;
+            }
+            case WM_DATE:
+            {
+                int y = 0;
+                unsigned mo = 0, d = 0;
+                if (sscanf(value.c_str(), "%d-%u-%u", &y, &mo, &d) < 3)
+                {
+                    vt_report_error(207, "DBLINK. Invalid watermark <%s> in <%s>", value.c_str(), file.c_str());
+                }
+                bind_date = {(SQLSMALLINT)y, (SQLUSMALLINT)mo, (SQLUSMALLINT)d};
+                break;
+            }
+            case WM_NUMERIC:
+            case WM_CHAR:
+                bind_str = value;
+                break;
+            default:
+                vt_report_error(207, "DBLINK. Invalid watermark kind <%s> in <%s>", skind.c_str(), file.c_str());
+            }
+        }
+
+        // Restricts query to the rows past the last mark
+        std::string filter(const std::string &query) const
+        {
+            std::string q = query.substr(0, query.find_last_not_of(" \n\t\r;") + 1);
+            return "SELECT * FROM (" + q + ") dblink_watermark WHERE " + column + " > ?";
+        }
+
+        // Orders query by column, restricted to the rows past the mark if there is one
+        std::string keyset(const std::string &query) const
+        {
+            std::string q = query.substr(0, query.find_last_not_of(" \n\t\r;") + 1);
+            return "SELECT * FROM (" + q + ") dblink_resume" + (hasMark() ? " WHERE " + column + " > ?" : "") + " ORDER BY " + column;
+        }
+
+        // Forgets the mark and the tracked value
+        void clear()
+        {
+            kind = WM_NONE;
+            new_kind = WM_NONE;
+            rows = 0;
+        }
+
+        // Makes the value tracked so far the mark bound to the "?" of filter()/keyset()
+        void advance()
+        {
+            if (new_kind == WM_NONE)
+            {
+                return;
+            }
+            kind = new_kind;
+            bind_int = new_int;
+            bind_ts = new_ts;
+            bind_digits = digits;
+            bind_date = new_date;
+            bind_str = new_str;
+        }
+
+        // Binds the last mark to the "?" added by filter()
+        SQLRETURN bind(SQLHSTMT Ost)
+        {
+            switch (kind)
+            {
+            case WM_INT:
+                return SQLBindParameter(Ost, 1, SQL_PARAM_INPUT, SQL_C_SBIGINT, SQL_BIGINT, 0, 0, &bind_int, 0, NULL);
+            case WM_TIMESTAMP:
+                return SQLBindParameter(Ost, 1, SQL_PARAM_INPUT, SQL_C_TIMESTAMP, SQL_TYPE_TIMESTAMP, bind_digits ? 20 + bind_digits : 19,
+                                        (SQLSMALLINT)bind_digits, &bind_ts, 0, NULL);
+            case WM_DATE:
+                return SQLBindParameter(Ost, 1, SQL_PARAM_INPUT, SQL_C_DATE, SQL_TYPE_DATE, 10, 0, &bind_date, 0, NULL);
+            case WM_NUMERIC:
+            {
+                size_t dot = bind_str.find('.');
+                SQLSMALLINT scale = (dot == std::string::npos) ? 0 : (SQLSMALLINT)(bind_str.size() - dot - 1);
+                bind_ind = SQL_NTS;
+                return SQLBindParameter(Ost, 1, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_NUMERIC, MAX_NUMERIC_CHARLEN, scale,
+                                        (SQLPOINTER)bind_str.c_str(), (SQLLEN)bind_str.size() + 1, &bind_ind);
+            }
+            default:
+                bind_ind = SQL_NTS;
+                return SQLBindParameter(Ost, 1, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_VARCHAR, bind_str.size() + 1, 0,
+                                        (SQLPOINTER)bind_str.c_str(), (SQLLEN)bind_str.size() + 1, &bind_ind);
+            }
+        }
+
+        // Kind of mark tracked for a remote column of ODBC type Odt
+        static WatermarkKinds kindOf(SQLSMALLINT Odt)
+        {
+            switch (Odt)
+            {
+            case SQL_SMALLINT:
+            case SQL_INTEGER:
+            case SQL_TINYINT:
+            case SQL_BIGINT:
+                return WM_INT;
+            case SQL_NUMERIC:
+            case SQL_DECIMAL:
+                return WM_NUMERIC;
+            case SQL_TYPE_TIMESTAMP:
+                return WM_TIMESTAMP;
+            case SQL_TYPE_DATE:
+                return WM_DATE;
+            case SQL_CHAR:
+            case SQL_VARCHAR:
+            case SQL_WCHAR:
+            case SQL_WVARCHAR:
+                return WM_CHAR;
+            default:
+                return WM_NONE;
+            }
+        }
+
+        // Keeps the highest value of the nfr rows of a bound column
+        void track(WatermarkKinds wk, bool textInt, SQLPOINTER Ores, SQLLEN *Olen, size_t desz, SQLULEN nfr)
+        {
+            for (SQLULEN i = 0; i < nfr; i++)
+            {
+                char *Odp = (char *)Ores + desz * i;
+                if (Olen[i] == SQL_NULL_DATA)
+                {
+                    continue;
+                }
+                switch (wk)
+                {
+                case WM_INT:
+                {
+                    SQLBIGINT v = textInt ? (SQLBIGINT)atoll(Odp) : *(SQLBIGINT *)Odp;
+                    if (new_kind == WM_NONE || ordered || v > new_int)
+                    {
+                        new_int = v;
+                    }
+                    break;
+                }
+                case WM_NUMERIC:
+                    if (*Odp != '\0' && (new_kind == WM_NONE || ordered || decimalCompare(Odp, new_str.c_str()) > 0))
+                    {
+                        new_str = Odp;
+                    }
+                    break;
+                case WM_TIMESTAMP:
+                    if (new_kind == WM_NONE || ordered || tsLess(new_ts, *(SQL_TIMESTAMP_STRUCT *)Odp))
+                    {
+                        new_ts = *(SQL_TIMESTAMP_STRUCT *)Odp;
+                    }
+                    break;
+                case WM_DATE:
+                {
+                    SQL_DATE_STRUCT &d = *(SQL_DATE_STRUCT *)Odp;
+                    if (new_kind == WM_NONE || ordered || d.year > new_date.year || (d.year == new_date.year &&
+                                                                                    (d.month > new_date.month || (d.month == new_date.month && d.day > new_date.day))))
+                    {
+                        new_date = d;
+                    }
+                    break;
+                }
+                case WM_CHAR:
+                { // the remote collation orders ordered keys
+                    std::string v(Odp, strnlen(Odp, desz));
+                    if (new_kind == WM_NONE || ordered || v > new_str)
+                    {
+                        new_str = v;
+                    }
+                    break;
+                }
+                default:
+                    return;
+                }
+                new_kind = wk;
+            }
+        }
+
+        // Highest fetched value as a state file line "<KIND> <value>", or "" if no row was fetched
+        std::string mark() const
+        {
+            char buf[64];
+            std::string value = "";
+
+            switch (new_kind)
+            {
+            case WM_INT:
+                snprintf(buf, sizeof(buf), "%lld", (long long)new_int);
+                value = buf;
+                break;
+            case WM_TIMESTAMP:
+            {
+                unsigned f = (unsigned)new_ts.fraction;
+                for (int k = digits; k < 9; k++)
+                {
+                    f /= 10;
+                }
+                int len = snprintf(buf, sizeof(buf), "%04d-%02u-%02u %02u:%02u:%02u", new_ts.year, new_ts.month, new_ts.day,
+                                   new_ts.hour, new_ts.minute, new_ts.second);
+                if (digits > 0)
+                {
+                    snprintf(buf + len, sizeof(buf) - len, ".%0*u", digits, f);
+                }
+                value = buf;
+                break;
+            }
+            case WM_DATE:
+                snprintf(buf, sizeof(buf), "%04d-%02u-%02u", new_date.year, new_date.month, new_date.day);
+                value = buf;
+                break;
+            case WM_NUMERIC:
+            case WM_CHAR:
+                value = new_str;
+                break;
+            default:
+                return value;
+            }
+            return std::string(WM_KIND_NAMES[new_kind]) + " " + value;
+        }
+
+        // Persists the highest fetched value, and the rows emitted if set
+        void save()
+        {
+            char suffix[64];
+            std::string line = mark();
+
+            if (line.empty() || file.empty())
+            {
+                return;
+            }
+
+            // Write and rename, so a failure never leaves a truncated state file behind. The temporary
+            // file is unique to this writer, as the instances of a statement can share the state file
+            snprintf(suffix, sizeof(suffix), ".%ld.%p", (long)getpid(), (void *)this);
+            std::string tmp = file + suffix;
+            std::ofstream state(tmp, std::ios::trunc);
+            state << line << std::endl;
+            if (rows > 0)
+            {
+                state << "ROWS " << rows << std::endl;
+            }
+            state.close();
+            if (state.fail() || rename(tmp.c_str(), file.c_str()) != 0)
+            {
+                (void)unlink(tmp.c_str());
+                vt_report_error(208, "DBLINK. Error writing watermark to <%s>", file.c_str());
+            }
+        }
+    };
+
+    // Chrome trace-event file (JSON array format) of a DBLINK instance. Each event is a single O_APPEND
+    // write, so the instances of a node can share the file. The closing "]" is optional in this format
+    class TraceFile
+    {
+        int fd = -1;
+        long pid = 0;
+
+        void put(const char *event, int len)
+        {
+            if (len > 0)
+            {
+                (void)!write(fd, event, (size_t)len);
+            }
+        }
+
+    public:
+        bool enabled() const
+        {
+            return fd >= 0;
+        }
+
+        bool open(const std::string &path, const std::string &node)
+        {
+            char meta[256];
+            struct stat st;
+
+            fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+            if (fd < 0)
+            {
+                return false;
+            }
+            pid = (long)getpid();
+            (void)flock(fd, LOCK_EX); // only the first writer starts the array
+            if (fstat(fd, &st) == 0 && st.st_size == 0)
+            {
+                put("[\n", 2);
+            }
+            (void)flock(fd, LOCK_UN);
+            put(meta, snprintf(meta, sizeof(meta), "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%ld,\"args\":{\"name\":\"%s UDx\"}},\n",
+                               pid, node.c_str()));
+            return true;
+        }
+
+        void close()
+        {
+            if (fd >= 0)
+            {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+
+        // Microseconds of the monotonic clock, common to the processes of the host. 0 when disabled
+        int64_t now() const
+        {
+            if (fd < 0)
+            {
+                return 0;
+            }
+            return (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        // Complete event of the span started at start. args: JSON members, printf format
+        void span(const char *name, int64_t start, const char *args, ...) __attribute__((format(printf, 4, 5)))
+        {
+            char members[256];
+            char event[512];
+            va_list ap;
+
+            if (fd < 0)
+            {
+                return;
+            }
+            va_start(ap, args);
+            (void)vsnprintf(members, sizeof(members), args, ap);
+            va_end(ap);
+            int len = snprintf(event, sizeof(event), "{\"name\":\"%s\",\"cat\":\"dblink\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":%ld,\"tid\":%ld,\"args\":{%s}},\n",
+                               name, (long long)start, (long long)(now() - start), pid, (long)syscall(SYS_gettid), members);
+            put(event, std::min(len, (int)sizeof(event) - 1));
+        }
+
+        void span(const char *name, int64_t start)
+        {
+            span(name, start, "%s", "");
+        }
+
+        // Instant event, e.g. the cancel request
+        void instant(const char *name)
+        {
+            char event[256];
+
+            if (fd < 0)
+            {
+                return;
+            }
+            int len = snprintf(event, sizeof(event), "{\"name\":\"%s\",\"cat\":\"dblink\",\"ph\":\"i\",\"s\":\"p\",\"ts\":%lld,\"pid\":%ld,\"tid\":%ld},\n",
+                               name, (long long)now(), pid, (long)syscall(SYS_gettid));
+            put(event, std::min(len, (int)sizeof(event) - 1));
+        }
+    };
+
+    // Statement prepared by DBLinkFactory::getReturnType, with its connection and connection slot
+    struct Handoff
+    {
+        SQLHENV Oenv = nullptr;
+        SQLHDBC Ocon = nullptr;
+        SQLHSTMT Ost = nullptr;
+        DBs dbt = GENERIC;
+        std::string member; // connection string the statement was prepared on (the routed replica)
+        GovernorSlot conn_slot;
+        std::chrono::steady_clock::time_point expires;
+
+        ~Handoff()
+        {
+            clean(Ost, Ocon, Oenv);
+        }
+    };
+
+    // Process wide registry where the factory parks its statement for the DBLink instance running the same
+    // query on the same CID. A reaper thread, running while statements are parked, closes the statements not
+    // claimed within HANDOFF_SECONDS, along with their connections and slots
+    class HandoffRegistry
+    {
+        std::mutex lock;
+        std::condition_variable cv;
+        std::map<std::string, std::unique_ptr<Handoff>> parked;
+        std::thread reaper;
+        bool reaping = false;
+        bool stopping = false;
+
+        // Removes the expired statements, returned to be closed once lock is released. Called with lock held
+        std::vector<std::unique_ptr<Handoff>> sweep()
+        {
+            std::vector<std::unique_ptr<Handoff>> expired;
+            auto now = std::chrono::steady_clock::now();
+            for (auto it = parked.begin(); it != parked.end();)
+            {
+                if (it->second->expires <= now)
+                {
+                    expired.push_back(std::move(it->second));
+                    it = parked.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+            return expired;
+        }
+
+        // Reaper thread: sleeps until the next expiry and closes the expired statements, until none is parked
+        void reap()
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            while (!stopping && !parked.empty())
+            {
+                auto next = parked.begin()->second->expires;
+                for (auto &p : parked)
+                {
+                    next = std::min(next, p.second->expires);
+                }
+                cv.wait_until(guard, next);
+                std::vector<std::unique_ptr<Handoff>> expired = sweep();
+                guard.unlock();
+                expired.clear(); // disconnects outside of the lock
+                guard.lock();
+            }
+            reaping = false;
+        }
+
+    public:
+        ~HandoffRegistry()
+        {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stopping = true;
+            }
+            cv.notify_all();
+            if (reaper.joinable())
+            {
+                reaper.join();
+            }
+        }
+
+        static HandoffRegistry &instance()
+        {
+            static HandoffRegistry registry;
+            return registry;
+        }
+
+        // A replica group is keyed by all its members, since the factory and the instance may be routed to
+        // different ones
+        static std::string key(const std::vector<std::string> &replicas, const std::string &cid_value, const std::string &query)
+        {
+            return cidKey(replicas, cid_value) + query;
+        }
+
+        // Parks h, replacing the statement of an earlier planning of the same query
+        void park(const std::string &key, std::unique_ptr<Handoff> h)
+        {
+            std::unique_ptr<Handoff> replaced; // closed once lock is released
+            std::lock_guard<std::mutex> guard(lock);
+            h->expires = std::chrono::steady_clock::now() + std::chrono::seconds(HANDOFF_SECONDS);
+            replaced = std::move(parked[key]);
+            parked[key] = std::move(h);
+            if (!reaping)
+            { // the previous reaper, if any, has left its loop
+                if (reaper.joinable())
+                {
+                    reaper.join();
+                }
+                reaping = true;
+                reaper = std::thread(&HandoffRegistry::reap, this);
+            }
+        }
+
+        std::unique_ptr<Handoff> claim(const std::string &key)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            auto it = parked.find(key);
+            if (it == parked.end())
+            {
+                return nullptr;
+            }
+            std::unique_ptr<Handoff> h = std::move(it->second);
+            parked.erase(it);
+            return h;
+        }
+    };
+
+    // Connection running a query on its own thread (StreamPull), with its own rowset buffers
+    struct RowsetStream
+    {
+        std::string node;
+        std::string connect;
+        std::string query;
+        SQLHENV Oenv = nullptr;
+        SQLHDBC Ocon = nullptr;
+        SQLHSTMT Ost = nullptr;
+        std::vector<std::vector<char>> buffers;
+        std::vector<std::vector<SQLLEN>> lengths;
+        std::vector<SQLPOINTER> Ores;
+        std::vector<SQLLEN *> Olen;
+        SQLULEN nfr = 0;
+        bool ready = false; // a fetched rowset waits for its conversion
+        bool done = false;
+        std::string error;
+        GovernorSlot slot;
+        GovernorSlot query_slot; // max_queries slot of a segment_table stream
+
+        ~RowsetStream()
+        {
+            clean(Ost, Ocon, Oenv);
+        }
+    };
+
+    // Rowset streams read on their own threads: one per remote node (segment_table), or the hedged replica (hedge).
+    // Each thread connects, executes and fetches its stream. The UDx thread converts the rowsets as they are fetched,
+    // and the stream fetches its next rowset once its buffers were converted. Stream threads must not call the
+    // Vertica SDK: errors are kept in the stream
+    class StreamPull
+    {
+        std::vector<std::unique_ptr<RowsetStream>> streams;
+        std::vector<std::thread> threads;
+        std::mutex mtx;
+        std::condition_variable cv;
+        bool stopping = false;
+        size_t turn = 0;
+
+        void fail(RowsetStream &s, SQLSMALLINT htype, SQLHANDLE Oh, const char *what)
+        {
+            std::string diag = htype ? diagText(htype, Oh) : "";
+            std::lock_guard<std::mutex> guard(mtx);
+            s.error = std::string(what) + (diag.empty() ? "" : ". " + diag);
+            s.done = true;
+            cv.notify_all();
+        }
+
+        void run(RowsetStream &s, const std::vector<SQLSMALLINT> &Octype, const std::vector<size_t> &desz, size_t rowset)
+        {
+            SQLHENV Oenv = nullptr;
+            SQLHDBC Ocon = nullptr;
+            SQLHSTMT Ost = nullptr;
+            SQLRETURN Oret = 0;
+
+            if (!SQL_SUCCEEDED(Oret = SQLAllocHandle(SQL_HANDLE_ENV, (SQLHANDLE)SQL_NULL_HANDLE, &Oenv)) ||
+                !SQL_SUCCEEDED(Oret = SQLSetEnvAttr(Oenv, SQL_ATTR_ODBC_VERSION, (void *)SQL_OV_ODBC3, 0)) ||
+                !SQL_SUCCEEDED(Oret = SQLAllocHandle(SQL_HANDLE_DBC, Oenv, &Ocon)))
+            {
+                clean(Ost, Ocon, Oenv);
+                return fail(s, 0, nullptr, "Error allocating Connection Handle");
+            }
+            {
+                std::lock_guard<std::mutex> guard(mtx);
+                s.Oenv = Oenv;
+                s.Ocon = Ocon;
+            }
+            if (!SQL_SUCCEEDED(Oret = SQLDriverConnect(Ocon, (SQLHWND)NULL, (SQLCHAR *)s.connect.c_str(), SQL_NTS, NULL, 0, NULL, SQL_DRIVER_NOPROMPT)))
+            {
+                return fail(s, SQL_HANDLE_DBC, Ocon, "Error connecting to the node");
+            }
+            if (!SQL_SUCCEEDED(Oret = SQLAllocHandle(SQL_HANDLE_STMT, Ocon, &Ost)))
+            {
+                return fail(s, SQL_HANDLE_DBC, Ocon, "Error allocating Statement Handle");
+            }
+            {
+                std::lock_guard<std::mutex> guard(mtx);
+                s.Ost = Ost;
+                if (stopping)
+                { // canceled while connecting
+                    s.done = true;
+                    return;
+                }
+            }
+
+            // Bind the buffers as DBLink::prepare bound the described statement:
+            s.buffers.resize(desz.size());
+            s.lengths.resize(desz.size());
+            s.Ores.resize(desz.size());
+            s.Olen.resize(desz.size());
+            for (size_t j = 0; j < desz.size(); j++)
+            {
+                s.buffers[j].resize(desz[j] * rowset);
+                s.lengths[j].resize(rowset);
+                s.Ores[j] = (SQLPOINTER)s.buffers[j].data();
+                s.Olen[j] = s.lengths[j].data();
+                if (!SQL_SUCCEEDED(Oret = SQLBindCol(Ost, (SQLUSMALLINT)(j + 1), Octype[j], s.Ores[j], (SQLLEN)desz[j], s.Olen[j])))
+                {
+                    return fail(s, SQL_HANDLE_STMT, Ost, "Error binding column");
+                }
+            }
+            if (!SQL_SUCCEEDED(Oret = SQLSetStmtAttr(Ost, SQL_ATTR_ROW_BIND_TYPE, (SQLPOINTER)SQL_BIND_BY_COLUMN, 0)) ||
+                !SQL_SUCCEEDED(Oret = SQLSetStmtAttr(Ost, SQL_ATTR_ROW_ARRAY_SIZE, (SQLPOINTER)rowset, 0)) ||
+                !SQL_SUCCEEDED(Oret = SQLSetStmtAttr(Ost, SQL_ATTR_ROWS_FETCHED_PTR, &s.nfr, 0)))
+            {
+                return fail(s, SQL_HANDLE_STMT, Ost, "Error setting statement attributes");
+            }
+            if (!SQL_SUCCEEDED(Oret = SQLExecDirect(Ost, (SQLCHAR *)s.query.c_str(), SQL_NTS)) && Oret != SQL_NO_DATA)
+            {
+                return fail(s, SQL_HANDLE_STMT, Ost, "Error executing the statement");
+            }
+
+            // Fetch loop, one rowset ahead of the conversion at most:
+            while (Oret != SQL_NO_DATA)
+            {
+                {
+                    std::unique_lock<std::mutex> lk(mtx);
+                    cv.wait(lk, [&] { return !s.ready || stopping; });
+                    if (stopping)
+                    {
+                        break;
+                    }
+                }
+                Oret = SQLFetchScroll(Ost, SQL_FETCH_NEXT, 0);
+                if (Oret == SQL_NO_DATA)
+                {
+                    break;
+                }
+                if (!SQL_SUCCEEDED(Oret))
+                {
+                    return fail(s, SQL_HANDLE_STMT, Ost, "Error fetching rows");
+                }
+                std::lock_guard<std::mutex> guard(mtx);
+                s.ready = true;
+                cv.notify_all();
+            }
+            std::lock_guard<std::mutex> guard(mtx);
+            s.done = true;
+            cv.notify_all();
+        }
+
+    public:
+        ~StreamPull()
+        {
+            stop();
+        }
+
+        // Adds the stream of a node. Streams are started together by start()
+        RowsetStream &add(const std::string &node, const std::string &connect, const std::string &query)
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            streams.emplace_back(new RowsetStream());
+            streams.back()->node = node;
+            streams.back()->connect = connect;
+            streams.back()->query = query;
+            return *streams.back();
+        }
+
+        void start(const std::vector<SQLSMALLINT> &Octype, const std::vector<size_t> &desz, size_t rowset)
+        {
+            for (auto &s : streams)
+            {
+                RowsetStream *sp = s.get();
+                threads.emplace_back([this, sp, Octype, desz, rowset] { run(*sp, Octype, desz, rowset); });
+            }
+        }
+
+        // Waits for a fetched rowset (or a failed stream, see RowsetStream::error), taking the streams in turn.
+        // nullptr once every stream is done or the pull was canceled
+        RowsetStream *next()
+        {
+            std::unique_lock<std::mutex> lk(mtx);
+            for (;;)
+            {
+                bool all_done = true;
+                for (size_t k = 0; k < streams.size() && !stopping; k++)
+                {
+                    RowsetStream *s = streams[(turn + k) % streams.size()].get();
+                    if (s->ready || !s->error.empty())
+                    {
+                        turn = (turn + k + 1) % streams.size();
+                        return s;
+                    }
+                    all_done = all_done && s->done;
+                }
+                if (all_done || stopping)
+                {
+                    return nullptr;
+                }
+                cv.wait(lk);
+            }
+        }
+
+        // Waits for the first stream answering: a fetched rowset, the end of its result set or an error.
+        // nullptr if the pull was canceled
+        RowsetStream *answer()
+        {
+            std::unique_lock<std::mutex> lk(mtx);
+            for (;;)
+            {
+                for (size_t k = 0; k < streams.size() && !stopping; k++)
+                {
+                    if (streams[k]->ready || streams[k]->done)
+                    {
+                        return streams[k].get();
+                    }
+                }
+                if (stopping)
+                {
+                    return nullptr;
+                }
+                cv.wait(lk);
+            }
+        }
+
+        // The rowset of s was converted: its thread fetches the next one into the same buffers
+        void release(RowsetStream *s)
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            s->ready = false;
+            cv.notify_all();
+        }
+
+        // Cancels the running statements. Called from DBLink::cancel
+        void cancel()
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            stopping = true;
+            for (auto &s : streams)
+            {
+                if (s->Ost)
+                {
+                    (void)SQLCancel(s->Ost);
+                }
+            }
+            cv.notify_all();
+        }
+
+        // Cancels the streams still running, waits for their threads and closes their connections
+        void stop()
+        {
+            cancel();
+            for (auto &t : threads)
+            {
+                t.join();
+            }
+            threads.clear();
+            std::lock_guard<std::mutex> guard(mtx);
+            streams.clear();
+            stopping = false;
+            turn = 0;
+        }
+    };
+
+    // Hedged execution on a replica group (hedge): when the first rowset of the primary replica takes longer than
+    // the delay, the query is sent to the next replica, and the replica answering first is read while the other
+    // one is canceled. The watchdog thread must not call the Vertica SDK
+    class HedgedRead
+    {
+        enum HedgeStates
+        {
+            HEDGE_WAITING = 0,
+            HEDGE_PRIMARY,
+            HEDGE_SECONDARY
+        };
+
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::thread watchdog;
+        HedgeStates state = HEDGE_WAITING;
+        bool armed = false;
+        std::chrono::steady_clock::time_point start;
+        long latency = -1;
+
+        static long since(std::chrono::steady_clock::time_point t)
+        {
+            return (long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t).count();
+        }
+
+        void watch(SQLHSTMT Ost, long delay_ms, const std::string &connect, const std::string &query,
+                   const std::vector<SQLSMALLINT> &Octype, const std::vector<size_t> &desz, size_t rowset)
+        {
+            std::unique_lock<std::mutex> lk(mtx);
+            if (cv.wait_for(lk, std::chrono::milliseconds(delay_ms), [this] { return state != HEDGE_WAITING; }))
+            {
+                return;
+            }
+            auto launched = std::chrono::steady_clock::now();
+            pull.add("hedge", connect, query);
+            pull.start(Octype, desz, rowset);
+            lk.unlock();
+
+            RowsetStream *s = pull.answer();
+            lk.lock();
+            if (s && !s->error.empty())
+            {
+                error = s->error;
+            }
+            else if (s && state == HEDGE_WAITING)
+            { // the primary is still waiting for its first rowset: cancel it
+                state = HEDGE_SECONDARY;
+                latency = since(launched);
+                (void)SQLCancel(Ost);
+            }
+        }
+
+    public:
+        StreamPull pull;   // hedged replica stream
+        std::string error; // hedged replica failure, logged by the UDx thread
+        long delay = -1;   // ms before the query was hedged
+
+        ~HedgedRead()
+        {
+            finish();
+        }
+
+        // Starts timing the query executed on Ost. Unless delay_ms is negative, the watchdog sends the query to
+        // the connect replica once the delay is over
+        void arm(SQLHSTMT Ost, long delay_ms, const std::string &connect, const std::string &query,
+                 const std::vector<SQLSMALLINT> &Octype, const std::vector<size_t> &desz, size_t rowset)
+        {
+            finish();
+            state = HEDGE_WAITING;
+            latency = -1;
+            error.clear();
+            delay = delay_ms;
+            armed = true;
+            start = std::chrono::steady_clock::now();
+            if (delay_ms >= 0 && !connect.empty())
+            {
+                watchdog = std::thread([=] { watch(Ost, delay_ms, connect, query, Octype, desz, rowset); });
+            }
+        }
+
+        bool pending()
+        {
+            return armed;
+        }
+
+        // Called by the UDx thread when the first fetch of the primary returned. True if the hedged replica
+        // answered first, the primary was canceled and the query is read from pull
+        bool settle()
+        {
+            std::unique_lock<std::mutex> lk(mtx);
+            armed = false;
+            if (state == HEDGE_WAITING)
+            {
+                state = HEDGE_PRIMARY;
+                latency = since(start);
+            }
+            bool hedged = (state == HEDGE_SECONDARY);
+            lk.unlock();
+            cv.notify_all();
+            if (!hedged)
+            {
+                pull.cancel();
+            }
+            return hedged;
+        }
+
+        // Milliseconds to the first rowset of the replica read, -1 if the query did not get there
+        long firstRowset()
+        {
+            return latency;
+        }
+
+        // Keeps the watchdog from hedging or canceling the primary, and cancels the hedged stream
+        void disarm()
+        {
+            {
+                std::lock_guard<std::mutex> guard(mtx);
+                armed = false;
+                if (state == HEDGE_WAITING)
+                {
+                    state = HEDGE_PRIMARY;
+                }
+            }
+            cv.notify_all();
+            pull.cancel();
+        }
+
+        // Stops the watchdog and the hedged stream
+        void finish()
+        {
+            disarm();
+            if (watchdog.joinable())
+            {
+                watchdog.join();
+            }
+            pull.stop();
+        }
+    };
+
+    // Result set source used in place of the ODBC code path
+    class DBLinkBackend
+    {
+    public:
+        virtual ~DBLinkBackend() {}
+
+        // Adds the output columns of the query (or the "dblink" status column) to outputTypes
+        virtual void describe(ServerInterface &srvInterface, SizedColumnTypes &outputTypes) = 0;
+
+        // Runs the query and writes its result set (or status) to outputWriter
+        virtual void fetch(ServerInterface &srvInterface, PartitionWriter &outputWriter) = 0;
+
+        // Called by DBLink::cancel(), possibly while fetch() is running in another thread
+        virtual void cancel() = 0;
+    };
+
+#ifdef DBLINK_ADBC
+#define ARROW_DAYS_TO_2000 10957LL                // Days between Unix and Vertica epochs
+#define ARROW_US_TO_2000 946684800000000LL        // Microseconds between Unix and Vertica epochs
+
+    enum ArrowCols
+    {
+        ARROW_UNSUPPORTED = 0,
+        ARROW_BOOL,
+        ARROW_INT8,
+        ARROW_INT16,
+        ARROW_INT32,
+        ARROW_INT64,
+        ARROW_UINT8,
+        ARROW_UINT16,
+        ARROW_UINT32,
+        ARROW_UINT64,
+        ARROW_FLOAT,
+        ARROW_DOUBLE,
+        ARROW_DECIMAL,
+        ARROW_STRING,
+        ARROW_LARGE_STRING,
+        ARROW_DATE32,
+        ARROW_DATE64,
+        ARROW_TIME32,
+        ARROW_TIME64,
+        ARROW_TIMESTAMP,
+        ARROW_INTERVAL_MONTHS,
+        ARROW_INTERVAL_DAY_TIME,
+        ARROW_DURATION
+    };
+
+    struct ArrowCol
+    {
+        ArrowCols type;
+        int64_t unit;    // Nanoseconds per unit for temporal types
+        int32 precision; // DECIMAL precision
+        int32 scale;     // DECIMAL scale
+        bool binary;     // Binary (not UTF-8) string types
+        bool tz;         // Timestamp with time zone
+    };
+
+    int64_t arrowUnit(char u)
+    {
+        switch (u)
+        {
+        case 's':
+            return 1000000000LL;
+        case 'm':
+            return 1000000LL;
+        case 'u':
+            return 1000LL;
+        case 'n':
+            return 1LL;
+        default:
+            return 0;
+        }
+    }
+
+    // Maps an Arrow C data interface format string (https://arrow.apache.org/docs/format/CDataInterface.html)
+    ArrowCol getArrowCol(const ArrowSchema *s)
+    {
+        ArrowCol c = {ARROW_UNSUPPORTED, 0, 0, 0, false, false};
+        const char *f = s->format;
+
+        if (s->dictionary != nullptr || f == nullptr || f[0] == '\0')
+        {
+            return c;
+        }
+        if (f[1] == '\0')
+        {
+            switch (f[0])
+            {
+            case 'b':
+                c.type = ARROW_BOOL;
+                break;
+            case 'c':
+                c.type = ARROW_INT8;
+                break;
+            case 's':
+                c.type = ARROW_INT16;
+                break;
+            case 'i':
+                c.type = ARROW_INT32;
+                break;
+            case 'l':
+                c.type = ARROW_INT64;
+                break;
+            case 'C':
+                c.type = ARROW_UINT8;
+                break;
+            case 'S':
+                c.type = ARROW_UINT16;
+                break;
+            case 'I':
+                c.type = ARROW_UINT32;
+                break;
+            case 'L':
+                c.type = ARROW_UINT64;
+                break;
+            case 'f':
+                c.type = ARROW_FLOAT;
+                break;
+            case 'g':
+                c.type = ARROW_DOUBLE;
+                break;
+            case 'z':
+                c.binary = true; // fall through
+            case 'u':
+                c.type = ARROW_STRING;
+                break;
+            case 'Z':
+                c.binary = true; // fall through
+            case 'U':
+                c.type = ARROW_LARGE_STRING;
+                break;
+            }
+        }
+        else if (f[0] == 'd' && f[1] == ':')
+        { // d:precision,scale[,bitwidth] (only 128 bits)
+            int bits = 128;
+            if (sscanf(f + 2, "%d,%d,%d", &c.precision, &c.scale, &bits) >= 2 && bits == 128)
+            {
+                c.type = ARROW_DECIMAL;
+            }
+        }
+        else if (f[0] == 't')
+        {
+            if (!strcmp(f, "tdD"))
+            {
+                c.type = ARROW_DATE32;
+            }
+            else if (!strcmp(f, "tdm"))
+            {
+                c.type = ARROW_DATE64;
+            }
+            else if (f[1] == 't' && (c.unit = arrowUnit(f[2])))
+            {
+                c.type = (f[2] == 's' || f[2] == 'm') ? ARROW_TIME32 : ARROW_TIME64;
+            }
+            else if (f[1] == 's' && (c.unit = arrowUnit(f[2])) && f[3] == ':')
+            {
+                c.type = ARROW_TIMESTAMP;
+                c.tz = (f[4] != '\0');
+            }
+            else if (f[1] == 'D' && (c.unit = arrowUnit(f[2])))
+            {
+                c.type = ARROW_DURATION;
+            }
+            else if (!strcmp(f, "tiM"))
+            {
+                c.type = ARROW_INTERVAL_MONTHS;
+            }
+            else if (!strcmp(f, "tiD"))
+            {
+                c.type = ARROW_INTERVAL_DAY_TIME;
+            }
+        }
+        return c;
+    }
+
+    // Converts an Arrow temporal value to microseconds
+    inline int64_t arrowToMicros(int64_t v, int64_t unit)
+    {
+        return (unit >= 1000) ? v * (unit / 1000) : v / 1000;
+    }
+
+    // Converts a little endian two's complement DECIMAL128 to text
+    size_t decimal128ToString(const uint8_t *p, int32 scale, char *out)
+    {
+        __int128 v;
+        char digits[48];
+        size_t n = 0;
+        size_t len = 0;
+
+        memcpy(&v, p, sizeof(v));
+        bool neg = (v < 0);
+        unsigned __int128 u = neg ? -(unsigned __int128)v : (unsigned __int128)v;
+        do
+        {
+            digits[n++] = (char)('0' + (int)(u % 10));
+            u /= 10;
+        } while (u != 0);
+        while ((int32)n <= scale)
+        {
+            digits[n++] = '0';
+        }
+        if (neg)
+        {
+            out[len++] = '-';
+        }
+        while (n > 0)
+        {
+            if ((int32)n == scale)
+            {
+                out[len++] = '.';
+            }
+            out[len++] = digits[--n];
+        }
+        out[len] = '\0';
+        return len;
+    }
+
+    class AdbcBackend : public DBLinkBackend
+    {
+        struct AdbcDatabase Odb;
+        struct AdbcConnection Oadc;
+        struct AdbcStatement Oast;
+        struct AdbcError Oaerr;
+        bool db_init = false;
+        bool con_init = false;
+        bool st_init = false;
+        std::mutex st_lock; // guards Oast and st_init against cancel() running on another thread
+
+        std::string options = "";
+        std::string query = "";
+        bool is_select = false;
+        std::atomic<bool> canceled;
+
+        void release()
+        {
+            {
+                std::lock_guard<std::mutex> guard(st_lock);
+                if (st_init)
+                {
+                    st_init = false;
+                    (void)AdbcStatementRelease(&Oast, &Oaerr);
+                }
+            }
+            if (con_init)
+            {
+                (void)AdbcConnectionRelease(&Oadc, &Oaerr);
+                con_init = false;
+            }
+            if (db_init)
+            {
+                (void)AdbcDatabaseRelease(&Odb, &Oaerr);
+                db_init = false;
+            }
+            clearError();
+        }
+
+        void clearError()
+        {
+            if (Oaerr.release)
+            {
+                Oaerr.release(&Oaerr);
+            }
+            memset(&Oaerr, 0, sizeof(Oaerr));
+        }
+
+        void check(AdbcStatusCode Oarc, int loc, const char *vtext)
+        {
+            if (Oarc != ADBC_STATUS_OK)
+            {
+                std::string msg = (Oaerr.message != nullptr) ? Oaerr.message : "no details";
+                release();
+                vt_report_error(loc, "DBLINK. %s. ADBC status %d. Error text: %s", vtext, (int)Oarc, msg.c_str());
+            }
+        }
+
+        void connect()
+        {
+            std::stringstream ss(options);
+            std::string token;
+
+            check(AdbcDatabaseNew(&Odb, &Oaerr), 601, "Error allocating ADBC database");
+            db_init = true;
+            while (std::getline(ss, token, ';'))
+            { // driver=<library>;entrypoint=<symbol>;<driver specific options>
+                size_t pos = token.find('=');
+                if (pos != std::string::npos)
+                {
+                    check(AdbcDatabaseSetOption(&Odb, token.substr(0, pos).c_str(), token.substr(pos + 1).c_str(), &Oaerr),
+                          602, "Error setting ADBC database option");
+                }
+            }
+            check(AdbcDatabaseInit(&Odb, &Oaerr), 603, "Error loading ADBC driver");
+            check(AdbcConnectionNew(&Oadc, &Oaerr), 604, "Error allocating ADBC connection");
+            con_init = true;
+            check(AdbcConnectionInit(&Oadc, &Odb, &Oaerr), 604, "Error connecting to target database");
+            AdbcStatusCode Oarc;
+            {
+                std::lock_guard<std::mutex> guard(st_lock);
+                Oarc = AdbcStatementNew(&Oadc, &Oast, &Oaerr);
+                st_init = (Oarc == ADBC_STATUS_OK);
+            }
+            check(Oarc, 605, "Error allocating ADBC statement");
+            check(AdbcStatementSetSqlQuery(&Oast, query.c_str(), &Oaerr), 606, "Error preparing the statement");
+        }
+
+    public:
+        AdbcBackend(const std::string &opts, const std::string &q, bool sel)
+            : options(opts), query(q), is_select(sel), canceled(false)
+        {
+            memset(&Odb, 0, sizeof(Odb));
+            memset(&Oadc, 0, sizeof(Oadc));
+            memset(&Oast, 0, sizeof(Oast));
+            memset(&Oaerr, 0, sizeof(Oaerr));
+        }
+
+        ~AdbcBackend()
+        {
+            release();
+        }
+
+        void describe(ServerInterface &srvInterface, SizedColumnTypes &outputTypes)
+        {
+            struct ArrowSchema Osch;
+            AdbcStatusCode Oarc;
+
+            if (!is_select)
+            {
+                outputTypes.addInt("dblink");
+                return;
+            }
+
+            connect();
+            memset(&Osch, 0, sizeof(Osch));
+            if ((Oarc = AdbcStatementExecuteSchema(&Oast, &Osch, &Oaerr)) == ADBC_STATUS_NOT_IMPLEMENTED)
+            { // ADBC 1.0 drivers: the schema comes with the result stream of a zero rows probe,
+              // or of the query itself when the driver's dialect rejects the probe
+                struct ArrowArrayStream Ostr;
+                std::string probe = "SELECT * FROM (" + query + ") dblink_describe WHERE 1 = 0";
+                memset(&Ostr, 0, sizeof(Ostr));
+                clearError();
+                check(AdbcStatementSetSqlQuery(&Oast, probe.c_str(), &Oaerr), 606, "Error preparing the statement");
+                if (AdbcStatementExecuteQuery(&Oast, &Ostr, nullptr, &Oaerr) != ADBC_STATUS_OK)
+                {
+                    srvInterface.log("DBLinkFactory ADBC driver rejected the describe probe: executing the query to describe it");
+                    clearError();
+                    memset(&Ostr, 0, sizeof(Ostr));
+                    check(AdbcStatementSetSqlQuery(&Oast, query.c_str(), &Oaerr), 606, "Error preparing the statement");
+                    check(AdbcStatementExecuteQuery(&Oast, &Ostr, nullptr, &Oaerr), 607, "Error executing the statement");
+                }
+                if (Ostr.get_schema(&Ostr, &Osch) != 0)
+                {
+                    Ostr.release(&Ostr);
+                    check(ADBC_STATUS_NOT_IMPLEMENTED, 607, "Error getting result set schema");
+                }
+                Ostr.release(&Ostr);
+            }
+            else
+            {
+                check(Oarc, 607, "Error getting result set schema");
+            }
+
+            for (int64_t j = 0; j < Osch.n_children; j++)
+            {
+                const ArrowSchema *cs = Osch.children[j];
+                ArrowCol c = getArrowCol(cs);
+                std::string cname = (cs->name != nullptr) ? cs->name : "";
+#ifdef DBLINK_DEBUG
+                srvInterface.log("DEBUG DBLinkFactory ADBC src column=%ld name=%s format=%s", (long)j, cname.c_str(), cs->format);
+#endif
+                switch (c.type)
+                {
+                case ARROW_BOOL:
+                    outputTypes.addBool(cname);
+                    break;
+                case ARROW_INT8:
+                case ARROW_INT16:
+                case ARROW_INT32:
+                case ARROW_INT64:
+                case ARROW_UINT8:
+                case ARROW_UINT16:
+                case ARROW_UINT32:
+                    outputTypes.addInt(cname);
+                    break;
+                case ARROW_UINT64: // Values past INT64_MAX do not fit an INTEGER
+                    outputTypes.addNumeric(20, 0, cname);
+                    break;
+                case ARROW_FLOAT:
+                case ARROW_DOUBLE:
+                    outputTypes.addFloat(cname);
+                    break;
+                case ARROW_DECIMAL:
+                    outputTypes.addNumeric(c.precision, c.scale, cname);
+                    break;
+                case ARROW_STRING:
+                    if (c.binary)
+                    {
+                        outputTypes.addVarbinary(MAX_BINARY_LEN, cname);
+                    }
+                    else
+                    {
+                        outputTypes.addVarchar(MAX_CHAR_LEN, cname);
+                    }
+                    break;
+                case ARROW_LARGE_STRING:
+                    if (c.binary)
+                    {
+                        outputTypes.addLongVarbinary(MAX_LONGBINARY_LEN, cname);
+                    }
+                    else
+                    {
+                        outputTypes.addLongVarchar(MAX_LONGCHAR_LEN, cname);
+                    }
+                    break;
+                case ARROW_DATE32:
+                case ARROW_DATE64:
+                    outputTypes.addDate(cname);
+                    break;
+                case ARROW_TIME32:
+                case ARROW_TIME64:
+                    outputTypes.addTime(6, cname);
+                    break;
+                case ARROW_TIMESTAMP:
+                    if (c.tz)
+                    {
+                        outputTypes.addTimestampTz(6, cname);
+                    }
+                    else
+                    {
+                        outputTypes.addTimestamp(6, cname);
+                    }
+                    break;
+                case ARROW_INTERVAL_MONTHS:
+                    outputTypes.addIntervalYM(INTERVAL_YEAR2MONTH, cname);
+                    break;
+                case ARROW_INTERVAL_DAY_TIME:
+                case ARROW_DURATION:
+                    outputTypes.addInterval(6, INTERVAL_DAY2SECOND, cname);
+                    break;
+                default:
+                    if (Osch.release)
+                    {
+                        Osch.release(&Osch);
+                    }
+                    release();
+                    vt_report_error(121, "DBLinkFactory. Unsupported Arrow data type <%s> for column %ld", cs->format, (long)j);
+                }
+            }
+            if (Osch.release)
+            {
+                Osch.release(&Osch);
+            }
+            release();
+        }
+
+        void fetch(ServerInterface &srvInterface, PartitionWriter &outputWriter)
+        {
+            struct ArrowArrayStream Ostr;
+            struct ArrowSchema Osch;
+            struct ArrowArray Obatch;
+            StringParsers parser;
+            char Onum[MAX_NUMERIC_CHARLEN];
+            int64_t Orows = 0;
+            const SizedColumnTypes &outTypes = outputWriter.getTypeMetaData();
+            size_t ncol = outTypes.getColumnCount();
+
+            connect();
+            if (!is_select)
+            {
+                check(AdbcStatementExecuteQuery(&Oast, nullptr, &Orows, &Oaerr), 608, "Error executing statement");
+                outputWriter.setInt(0, (vint)ADBC_STATUS_OK);
+                outputWriter.next();
+                release();
+                return;
+            }
+
+            memset(&Ostr, 0, sizeof(Ostr));
+            memset(&Osch, 0, sizeof(Osch));
+            check(AdbcStatementExecuteQuery(&Oast, &Ostr, &Orows, &Oaerr), 609, "Error executing the statement");
+            if (Ostr.get_schema(&Ostr, &Osch) != 0 || (size_t)Osch.n_children != ncol)
+            {
+                if (Osch.release)
+                {
+                    Osch.release(&Osch);
+                }
+                Ostr.release(&Ostr);
+                check(ADBC_STATUS_NOT_IMPLEMENTED, 610, "Result set schema differs from the described one");
+            }
+            std::vector<ArrowCol> cols(ncol);
+            for (size_t j = 0; j < ncol; j++)
+            {
+                cols[j] = getArrowCol(Osch.children[j]);
+            }
+            Osch.release(&Osch);
+
+            // Batch loop:
+            while (!canceled)
+            {
+                memset(&Obatch, 0, sizeof(Obatch));
+                if (Ostr.get_next(&Ostr, &Obatch) != 0)
+                {
+                    std::string msg = (Ostr.get_last_error && Ostr.get_last_error(&Ostr)) ? Ostr.get_last_error(&Ostr) : "";
+                    Ostr.release(&Ostr);
+                    release();
+                    vt_report_error(611, "DBLINK. Error fetching record batch. Error text: %s", msg.c_str());
+                }
+                if (Obatch.release == nullptr)
+                { // End of stream
+                    break;
+                }
+#ifdef DBLINK_DEBUG
+                srvInterface.log("DEBUG DBLink ADBC rows fetched=%ld", (long)Obatch.length);
+#endif
+
+                for (int64_t i = 0; i < Obatch.length && !canceled; i++, outputWriter.next())
+                {
+                    for (size_t j = 0; j < ncol; j++)
+                    {
+                        const ArrowArray *a = Obatch.children[j];
+                        const uint8_t *valid = (const uint8_t *)a->buffers[0];
+                        const void *vals = a->buffers[1];
+                        int64_t k = a->offset + Obatch.offset + i;
+
+                        if (a->null_count != 0 && valid != nullptr && !(valid[k >> 3] & (1 << (k & 7))))
+                        {
+                            outputWriter.setNull(j);
+                            continue;
+                        }
+
+                        switch (cols[j].type)
+                        {
+                        case ARROW_BOOL:
+                            outputWriter.setBool(j, (((const uint8_t *)vals)[k >> 3] & (1 << (k & 7))) ? VTrue : VFalse);
+                            break;
+                        case ARROW_INT8:
+                            outputWriter.setInt(j, ((const int8_t *)vals)[k]);
+                            break;
+                        case ARROW_INT16:
+                            outputWriter.setInt(j, ((const int16_t *)vals)[k]);
+                            break;
+                        case ARROW_INT32:
+                            outputWriter.setInt(j, ((const int32_t *)vals)[k]);
+                            break;
+                        case ARROW_INT64:
+                            outputWriter.setInt(j, ((const int64_t *)vals)[k]);
+                            break;
+                        case ARROW_UINT8:
+                            outputWriter.setInt(j, ((const uint8_t *)vals)[k]);
+                            break;
+                        case ARROW_UINT16:
+                            outputWriter.setInt(j, ((const uint16_t *)vals)[k]);
+                            break;
+                        case ARROW_UINT32:
+                            outputWriter.setInt(j, ((const uint32_t *)vals)[k]);
+                            break;
+                        case ARROW_UINT64:
+                        {
+                            std::string rejectReason = "Unrecognized remote database format";
+                            int len = snprintf(Onum, sizeof(Onum), "%llu", (unsigned long long)((const uint64_t *)vals)[k]);
+                            if (!parser.parseNumeric(Onum, (size_t)len, j, outputWriter.getNumericRef(j), outTypes.getColumnType(j), rejectReason))
+                            {
+                                Obatch.release(&Obatch);
+                                Ostr.release(&Ostr);
+                                check(ADBC_STATUS_NOT_IMPLEMENTED, 404, "Error parsing Numeric");
+                            }
+                            break;
+                        }
+                        case ARROW_FLOAT:
+                            outputWriter.setFloat(j, ((const float *)vals)[k]);
+                            break;
+                        case ARROW_DOUBLE:
+                            outputWriter.setFloat(j, ((const double *)vals)[k]);
+                            break;
+                        case ARROW_DECIMAL:
+                        {
+                            std::string rejectReason = "Unrecognized remote database format";
+                            size_t len = decimal128ToString((const uint8_t *)vals + k * 16, cols[j].scale, Onum);
+                            if (!parser.parseNumeric(Onum, len, j, outputWriter.getNumericRef(j), outTypes.getColumnType(j), rejectReason))
+                            {
+                                Obatch.release(&Obatch);
+                                Ostr.release(&Ostr);
+                                check(ADBC_STATUS_NOT_IMPLEMENTED, 404, "Error parsing Numeric");
+                            }
+                            break;
+                        }
+                        case ARROW_STRING:
+                        case ARROW_LARGE_STRING:
+                        {
+                            int64_t start, end;
+                            if (cols[j].type == ARROW_STRING)
+                            {
+                                start = ((const int32_t *)vals)[k];
+                                end = ((const int32_t *)vals)[k + 1];
+                            }
+                            else
+                            {
+                                start = ((const int64_t *)vals)[k];
+                                end = ((const int64_t *)vals)[k + 1];
+                            }
+                            size_t maxlen = (size_t)outTypes.getColumnType(j).getStringLength();
+                            outputWriter.getStringRef(j).copy((const char *)a->buffers[2] + start, std::min((size_t)(end - start), maxlen));
+                            break;
+                        }
+                        case ARROW_DATE32:
+                            outputWriter.setDate(j, (DateADT)((const int32_t *)vals)[k] - ARROW_DAYS_TO_2000);
+                            break;
+                        case ARROW_DATE64:
+                            outputWriter.setDate(j, (DateADT)(((const int64_t *)vals)[k] / 86400000LL) - ARROW_DAYS_TO_2000);
+                            break;
+                        case ARROW_TIME32:
+                            outputWriter.setTime(j, (TimeADT)arrowToMicros(((const int32_t *)vals)[k], cols[j].unit));
+                            break;
+                        case ARROW_TIME64:
+                            outputWriter.setTime(j, (TimeADT)arrowToMicros(((const int64_t *)vals)[k], cols[j].unit));
+                            break;
+                        case ARROW_TIMESTAMP:
+                        {
+                            Timestamp ts = (Timestamp)arrowToMicros(((const int64_t *)vals)[k], cols[j].unit) - ARROW_US_TO_2000;
+                            if (cols[j].tz)
+                            {
+                                outputWriter.setTimestampTz(j, ts);
+                            }
+                            else
+                            {
+                                outputWriter.setTimestamp(j, ts);
+                            }
+                            break;
+                        }
+                        case ARROW_INTERVAL_MONTHS:
+                            outputWriter.setInterval(j, (Interval)((const int32_t *)vals)[k]);
+                            break;
+                        case ARROW_INTERVAL_DAY_TIME:
+                        {
+                            const int32_t *dt = (const int32_t *)vals + k * 2;
+                            outputWriter.setInterval(j, (Interval)dt[0] * usPerDay + (Interval)dt[1] * 1000);
+                            break;
+                        }
+                        case ARROW_DURATION:
+                            outputWriter.setInterval(j, (Interval)arrowToMicros(((const int64_t *)vals)[k], cols[j].unit));
+                            break;
+                        default:
+                            Obatch.release(&Obatch);
+                            Ostr.release(&Ostr);
+                            release();
+                            vt_report_error(407, "DBLINK. Unsupported data type for column %zu", j);
+                        }
+                    }
+                }
+                Obatch.release(&Obatch);
+            }
+            Ostr.release(&Ostr);
+            release();
+        }
+
+        void cancel()
+        {
+            canceled = true;
+            std::lock_guard<std::mutex> guard(st_lock);
+            if (st_init)
+            {
+                struct AdbcError Ocerr;
+                memset(&Ocerr, 0, sizeof(Ocerr));
+                (void)AdbcStatementCancel(&Oast, &Ocerr);
+                if (Ocerr.release)
+                {
+                    Ocerr.release(&Ocerr);
+                }
+            }
+        }
+    };
+#endif
+
+    // Returns the backend serving cid_value, or nullptr for ODBC connection strings
+    DBLinkBackend *newBackend(const std::string &cid_value, const std::string &query, bool is_select)
+    {
+        if (strncasecmp(cid_value.c_str(), "ADBC:", 5))
+        {
+            return nullptr;
+        }
+#ifdef DBLINK_ADBC
+        return new AdbcBackend(cid_value.substr(5), query, is_select);
+#else
+        vt_report_error(205, "DBLINK. ADBC connections require DBLINK built with WITH_ADBC=1");
+#endif
+    }
+
+    // Writer of the conversion kernels (dblink_convert.h) over the PartitionWriter
+    class OutputColumnWriter
+    {
+        PartitionWriter &w;
+        StringParsers parser;
+        std::string rejectReason = "Unrecognized remote database format";
+
+    public:
+        OutputColumnWriter(PartitionWriter &writer) : w(writer) {}
+
+        inline void setNull(size_t j)
+        {
+            w.setNull(j);
+        }
+        inline void setInt(size_t j, int64_t v)
+        {
+            w.setInt(j, (vint)v);
+        }
+        inline void setFloat(size_t j, double v)
+        {
+            w.setFloat(j, (vfloat)v);
+        }
+        inline bool setNumeric(size_t j, char *text, size_t len)
+        {
+            return parser.parseNumeric(text, len, j, w.getNumericRef(j), w.getTypeMetaData().getColumnType(j), rejectReason);
+        }
+        inline void setString(size_t j, const char *s, size_t len)
+        {
+            w.getStringRef(j).copy(s, len);
+        }
+        inline void setBool(size_t j, bool v)
+        {
+            w.setBool(j, v ? VTrue : VFalse);
+        }
+        inline void setDate(size_t j, int64_t days)
+        {
+            w.setDate(j, (DateADT)days);
+        }
+        inline void setTime(size_t j, int64_t us)
+        {
+            w.setTime(j, (TimeADT)us);
+        }
+        inline void setTimestamp(size_t j, int64_t us)
+        {
+            w.setTimestamp(j, (Timestamp)us);
+        }
+        inline void setInterval(size_t j, int64_t v)
+        {
+            w.setInterval(j, (Interval)v);
+        }
+    };
+
+    class DBLink : public TransformFunction
+    {
+        SQLHENV Oenv = nullptr;
+        SQLHDBC Ocon = nullptr;
+        SQLHSTMT Ost = nullptr;
+
+        std::string cid_value = "";
+        std::string query = "";
+        std::string target = ""; // bulk export target table
+        vint commit_size = 0;    // bulk export rows per transaction, 0: one per partition
+        bool is_select = false;
+        bool pgcopy = false;
+        bool explain = false; // dry run: the binding and remote plans are returned instead of the rows
+        bool handoff = false; // the factory may have parked the statement of this query
+        std::string filter_key = ""; // remote column restricted to the input keys (semi-join pushdown)
+        SQLPOINTER Okey = nullptr;   // FILTER_KEYS input keys bound to the IN-list
+        SQLLEN *Okeylen = nullptr;
+        size_t keysz = 0;
+        std::string width_file = "";                      // observed widths cache (width_sample)
+        std::vector<std::pair<size_t, SQLULEN>> narrowed; // columns declared with their observed width, and remote width
+        bool adopted = false; // statement prepared by the factory, prepare() does not prepare it again
+        std::string segment_table = ""; // remote Vertica table whose segmentation splits the query across the nodes
+        StreamPull segments;
+        std::vector<std::string> replicas; // replica group members, the least loaded first
+        std::string latency_file = "";     // first rowset latencies of the replica group
+        InflightMark inflight;             // query outstanding on the replica
+        int hedge_pct = 0;                 // latency percentile before a query is hedged, 0: not hedged
+        HedgedRead hedge;
+        bool hedged = false; // the hedged replica answered first
+        bool direct_fetch = false; // the rowsets are fetched from the driver library, bypassing the driver manager
+        DirectFetch direct;
+        std::string parquet_path = "";   // directory the result set is written to as Parquet files, instead of returned
+        std::string parquet_prefix = ""; // file names of the instance
+        int64_t parquet_file_size = 0;   // bytes before a file is rolled
+        ParquetCodecs parquet_codec = PQ_GZIP;
+        std::vector<ParquetColumn> parquet_cols;
+        std::vector<std::string> parquet_files; // files written by the partition, removed if it fails
+        std::vector<std::string> cnames;        // lower case remote column names, as described by prepare()
+        size_t rowset;
+        std::unique_ptr<DBLinkBackend> backend;
+
+        // Per instance statement state, shared by all the partitions:
+        DBs dbt = GENERIC;
+        bool prepared = false;
+        bool executed = false;
+        Watermark watermark;
+        GovernorParams gov;
+        GovernorSlot conn_slot;
+        GovernorSlot query_slot;
+        int wm_idx = -1;
+        WatermarkKinds wm_kind = WM_NONE;
+        Watermark resume;         // last emitted key of a resumable extraction
+        std::string base_query;   // query as given, before the watermark filter or resume_key keyset
+        int max_retries = DEF_MAX_RETRIES;
+        int rs_idx = -1;
+        WatermarkKinds rs_kind = WM_NONE;
+        SQLUSMALLINT Oncol = 0;
+        SQLPOINTER *Ores = nullptr;
+        SQLLEN **Olen = nullptr;
+        std::vector<SQLSMALLINT> Odt;
+        std::vector<size_t> desz;
+        SQLULEN nfr = 0;
+        SQLUSMALLINT *Opst = nullptr; // bulk export parameter status array
+        size_t workers = 0;                // conversion threads, 0: the fetch thread converts the rowset
+        std::unique_ptr<ConvertPool> pool; // created by prepare() for multi column result sets
+        StagedValue *staged = nullptr;     // Oncol columns of rowset converted values
+        TraceFile trace;                   // trace_file events
+        unsigned long nfetch = 0;          // rowsets fetched, numbers the fetch probes
+#ifdef DBLINK_LIBPQ
+        PGconn *Opg = nullptr;
+        PGcancel *Opgc = nullptr; // cancel handle of Opg, freed before Opg is closed
+        std::mutex pg_lock;       // guards Opgc against cancel() running on another thread
+#endif
+
+        void setup(ServerInterface &srvInterface, const SizedColumnTypes &argTypes)
+        {
+            getCidValue(srvInterface, cid_value, &replicas);
+            ParamReader params = srvInterface.getParamReader();
+
+            // Route the queries of a replica group to its least loaded member:
+            if (replicas.size() > 1)
+            {
+                std::string members = "";
+                for (auto &r : replicas)
+                {
+                    members += r + "\n";
+                }
+                latency_file = std::string(DBLINK_GOVERNOR_DIR) + "/" + hashKey(members) + ".latency";
+                routeReplicas(replicas);
+                cid_value = replicas[0];
+                if (params.containsParameter("hedge"))
+                {
+                    hedge_pct = (int)params.getIntRef("hedge");
+                }
+            }
+
+            // Read direct_fetch Param:
+            if (params.containsParameter("direct_fetch"))
+            {
+                direct_fetch = params.getBoolRef("direct_fetch") == VTrue;
+            }
+
+            // Bulk export pushes the input columns to the target table instead of running a query:
+            if (params.containsParameter("target"))
+            {
+                target = params.getStringRef("target").str();
+                if (params.containsParameter("commit_size"))
+                {
+                    commit_size = params.getIntRef("commit_size");
+                }
+            }
+            else
+            {
+                getQuery(srvInterface, query, is_select);
+                base_query = query;
+                explain = params.containsParameter("explain") && params.getBoolRef("explain") == VTrue;
+                if (!explain)
+                {
+                    backend.reset(newBackend(cid_value, query, is_select));
+                }
+            }
+
+            // Read/Set rowset Param:
+            if (params.containsParameter("rowset"))
+            {
+                vint rowset_param = params.getIntRef("rowset");
+                if (rowset_param < 1 || rowset_param > MAX_ROWSET)
+                {
+                    ex_err(0, 0, 203, "DBLink. Error rowset out of range", Ost, Ocon, Oenv);
+                }
+                else
+                {
+                    rowset = (size_t)rowset_param;
+                }
+            }
+            else
+            {
+                rowset = DEF_ROWSET;
+            }
+
+            // Read pgcopy Param:
+            if (params.containsParameter("pgcopy"))
+            {
+                pgcopy = (params.getBoolRef("pgcopy") == VTrue);
+            }
+
+            // Read handoff Param (checked by the factory):
+            if (params.containsParameter("handoff"))
+            {
+                handoff = strcasecmp(params.getStringRef("handoff").str().c_str(), "none") != 0;
+            }
+
+            getGovernorParams(srvInterface, gov);
+
+            // Open the trace file (trace-event format) of this instance:
+            if (params.containsParameter("trace_file"))
+            {
+                std::string trace_file = params.getStringRef("trace_file").str();
+                if (!trace.open(trace_file, srvInterface.getCurrentNodeName()))
+                {
+                    srvInterface.log("DBLink unable to open trace file <%s>: %s", trace_file.c_str(), strerror(errno));
+                }
+            }
+
+            // Read workers Param (checked by the factory). pgcopy decodes the COPY stream on the fetch thread,
+            // and its ODBC fallback converts serially, as its memory request has no staging:
+            if (params.containsParameter("workers") && !pgcopy)
+            {
+                workers = (size_t)params.getIntRef("workers");
+            }
+
+            // Read watermark Params (checked by the factory):
+            if (params.containsParameter("watermark"))
+            {
+                watermark.column = params.getStringRef("watermark").str();
+                watermark.file = params.getStringRef("watermark_file").str();
+                watermark.load();
+                if (watermark.hasMark())
+                {
+                    query = watermark.filter(query);
+                }
+            }
+
+            // Values longer than the observed widths declared by the factory fail the query:
+            if (params.containsParameter("width_sample") && params.getIntRef("width_sample") > 0)
+            {
+                width_file = widthCacheFile(srvInterface, replicas, cid_value, base_query);
+            }
+
+            // Read filter_key Param (checked by the factory). Each execution gets an IN-list of FILTER_KEYS keys:
+            if (params.containsParameter("filter_key"))
+            {
+                filter_key = params.getStringRef("filter_key").str();
+                std::string q = query.substr(0, query.find_last_not_of(" \n\t\r;") + 1);
+                query = "SELECT * FROM (" + q + ") dblink_filter WHERE " + filter_key + " IN (?";
+                for (size_t k = 1; k < FILTER_KEYS; k++)
+                {
+                    query += ", ?";
+                }
+                query += ")";
+            }
+
+            // Read segment_table Param (checked by the factory):
+            if (params.containsParameter("segment_table"))
+            {
+                segment_table = params.getStringRef("segment_table").str();
+            }
+
+            // Read parquet Params (checked by the factory). The files are named after the node, process and instance:
+            if (params.containsParameter("parquet_path"))
+            {
+                static std::atomic<unsigned> instances(0);
+                vint file_mb = params.containsParameter("parquet_file_size") ? params.getIntRef("parquet_file_size") : DEF_PARQUET_FILE_MB;
+                parquet_path = params.getStringRef("parquet_path").str();
+                parquet_file_size = (int64_t)file_mb << 20;
+                if (params.containsParameter("parquet_compression") && !strcasecmp(params.getStringRef("parquet_compression").str().c_str(), "none"))
+                {
+                    parquet_codec = PQ_UNCOMPRESSED;
+                }
+                parquet_prefix = parquet_path + "/dblink-" + srvInterface.getCurrentNodeName() + "-" + std::to_string((long long)time(NULL)) + "-" +
+                                 std::to_string((long)getpid()) + "-" + std::to_string(instances++);
+            }
+
+            // Read resume Params (checked by the factory). A checkpoint left by a failed statement
+            // is not resumed: Vertica rolled back the rows that statement had emitted
+            if (params.containsParameter("resume_key"))
+            {
+                resume.column = params.getStringRef("resume_key").str();
+                resume.ordered = true;
+                if (params.containsParameter("checkpoint_file"))
+                {
+                    resume.file = params.getStringRef("checkpoint_file").str();
+                    std::ifstream leftover(resume.file);
+                    std::string line;
+                    if (leftover.is_open() && std::getline(leftover, line))
+                    {
+                        srvInterface.log("DBLink ignoring checkpoint <%s> of a previous run in <%s>", line.c_str(), resume.file.c_str());
+                    }
+                }
+                if (params.containsParameter("max_retries"))
+                {
+                    max_retries = (int)params.getIntRef("max_retries");
+                }
+                query = resume.keyset(base_query);
+            }
+        }
+
+        void cancel(ServerInterface &srvInterface)
+        {
+            SQLRETURN Oret = 0;
+            DBLINK_PROBE(cancel);
+            trace.instant("cancel");
+            if (backend)
+            {
+                backend->cancel();
+            }
+            segments.cancel();
+            hedge.disarm();
+#ifdef DBLINK_LIBPQ
+            {
+                std::lock_guard<std::mutex> guard(pg_lock);
+                if (Opgc)
+                {
+                    char errbuf[256];
+                    (void)PQcancel(Opgc, errbuf, (int)sizeof(errbuf));
+                }
+            }
+#endif
+            if (Ost)
+            {
+                if (!SQL_SUCCEEDED(Oret = SQLCancel(Ost)))
+                {
+                    ex_err(SQL_HANDLE_STMT, Ost, 301, "Error canceling SQL statement", Ost, Ocon, Oenv);
+                }
+            }
+            clean(Ost, Ocon, Oenv);
+        }
+
+        void destroy(ServerInterface &srvInterface, const SizedColumnTypes &argTypes)
+        {
+#ifdef DBLINK_DEBUG
+            srvInterface.log("DEBUG DBLink clean called in DBLink::destory");
+#endif
+            segments.stop();
+            hedge.finish();
+            direct.close();
+            clean(Ost, Ocon, Oenv);
+            releaseQuery();
+            conn_slot.release();
+            backend.reset();
+            pool.reset();
+            trace.close();
+#ifdef DBLINK_LIBPQ
+            pgClose();
+#endif
+        }
+
+#ifdef DBLINK_LIBPQ
+        // Connects Opg and creates the cancel handle cancel() uses
+        void pgConnect()
+        {
+            Opg = PQconnectdb(getPgConninfo(cid_value).c_str());
+            if (PQstatus(Opg) != CONNECTION_OK)
+            {
+                pgErr(501, "Error connecting to target database");
+            }
+            std::lock_guard<std::mutex> guard(pg_lock);
+            Opgc = PQgetCancel(Opg);
+        }
+
+        void pgFreeCancel()
+        {
+            std::lock_guard<std::mutex> guard(pg_lock);
+            if (Opgc)
+            {
+                PQfreeCancel(Opgc);
+                Opgc = nullptr;
+            }
+        }
+
+        void pgClose()
+        {
+            pgFreeCancel();
+            if (Opg)
+            {
+                PQfinish(Opg);
+                Opg = nullptr;
+            }
+        }
+
+        void pgErr(int loc, const char *vtext)
+        {
+            pgFreeCancel();
+            releaseQuery();
+            conn_slot.release();
+            pg_err(Opg, loc, vtext);
+        }
+
+        // Runs the SELECT as COPY (...) TO STDOUT (FORMAT binary) over libpq and decodes the tuple stream.
+        // Returns false (without writing any row) if a column cannot be decoded natively.
+        bool processPgCopy(ServerInterface &srvInterface, PartitionWriter &outputWriter)
+        {
+            const SizedColumnTypes &outTypes = outputWriter.getTypeMetaData();
+            size_t ncol = outTypes.getColumnCount();
+            std::vector<PgCols> pgc(ncol, PG_UNSUPPORTED);
+            std::string copyQuery = query;
+            std::string numeric;
+            StringParsers parser;
+            PGresult *Ores = nullptr;
+            char *buf = nullptr;
+            int len = 0;
+            bool header = false;
+
+            waitSlot(srvInterface, conn_slot, "connection", gov.max_connections);
+            pgConnect();
+            acquireQuery(srvInterface);
+
+            // Describe the statement to check every column has a native binary decoder:
+            copyQuery.erase(copyQuery.find_last_not_of(" \n\t\r;") + 1);
+            Ores = PQprepare(Opg, "", copyQuery.c_str(), 0, NULL);
+            if (PQresultStatus(Ores) != PGRES_COMMAND_OK)
+            {
+                PQclear(Ores);
+                pgErr(502, "Error preparing the statement");
+            }
+            PQclear(Ores);
+            Ores = PQdescribePrepared(Opg, "");
+            if (PQresultStatus(Ores) != PGRES_COMMAND_OK)
+            {
+                PQclear(Ores);
+                pgErr(502, "Error describing the statement");
+            }
+            bool supported = ((size_t)PQnfields(Ores) == ncol);
+            for (size_t j = 0; supported && j < ncol; j++)
+            {
+                pgc[j] = getPgCol(PQftype(Ores, (int)j), outTypes.getColumnType(j));
+                supported = (pgc[j] != PG_UNSUPPORTED);
+#ifdef DBLINK_DEBUG
+                srvInterface.log("DEBUG DBLink pgcopy column=%zu oid=%u decoder=%d", j, PQftype(Ores, (int)j), (int)pgc[j]);
+#endif
+            }
+            PQclear(Ores);
+            if (!supported)
+            {
+                srvInterface.log("DBLink pgcopy result set contains types without a binary decoder. Falling back to ODBC");
+                pgClose();
+                releaseQuery();
+                conn_slot.release();
+                return false;
+            }
+
+            // Start the COPY stream:
+            copyQuery = "COPY (" + copyQuery + ") TO STDOUT (FORMAT binary)";
+            Ores = PQexec(Opg, copyQuery.c_str());
+            if (PQresultStatus(Ores) != PGRES_COPY_OUT)
+            {
+                PQclear(Ores);
+                pgErr(503, "Error executing the COPY statement");
+            }
+            PQclear(Ores);
+
+            // Copy loop, one tuple per message:
+            while ((len = PQgetCopyData(Opg, &buf, 0)) > 0 && !isCanceled())
+            {
+                const char *p = buf;
+                const char *end = buf + len;
+
+                if (!header)
+                {
+                    if (len < 19 || memcmp(p, PGCOPY_SIGNATURE, sizeof(PGCOPY_SIGNATURE)))
+                    {
+                        PQfreemem(buf);
+                        pgErr(504, "Invalid COPY BINARY header");
+                    }
+                    p += sizeof(PGCOPY_SIGNATURE) + 4;
+                    p += 4 + pgInt32(p);
+                    header = true;
+                    if (p >= end)
+                    {
+                        PQfreemem(buf);
+                        continue;
+                    }
+                }
+
+                int16_t nfields = pgInt16(p);
+                p += 2;
+                if (nfields == -1)
+                { // File trailer
+                    PQfreemem(buf);
+                    continue;
+                }
+                if ((size_t)nfields != ncol)
+                {
+                    PQfreemem(buf);
+                    pgErr(505, "Unexpected number of fields in COPY tuple");
+                }
+
+                for (size_t j = 0; j < ncol; j++)
+                {
+                    int32_t fl = pgInt32(p);
+                    p += 4;
+                    if (fl == -1)
+                    {
+                        outputWriter.setNull(j);
+                        continue;
+                    }
+                    if (fl < 0 || p + fl > end)
+                    {
+                        PQfreemem(buf);
+                        pgErr(505, "Malformed COPY tuple");
+                    }
+
+                    switch (pgc[j])
+                    {
+                    case PG_INT:
+                        outputWriter.setInt(j, (fl == 2) ? pgInt16(p) : (fl == 4) ? (vint)pgInt32(p) : (vint)pgInt64(p));
+                        break;
+                    case PG_FLOAT4:
+                    {
+                        int32_t v = pgInt32(p);
+                        float f;
+                        memcpy(&f, &v, sizeof(f));
+                        outputWriter.setFloat(j, (vfloat)f);
+                        break;
+                    }
+                    case PG_FLOAT8:
+                    {
+                        int64_t v = pgInt64(p);
+                        double d;
+                        memcpy(&d, &v, sizeof(d));
+                        outputWriter.setFloat(j, (vfloat)d);
+                        break;
+                    }
+                    case PG_NUMERIC:
+                    {
+                        std::string rejectReason = "Unrecognized remote database format";
+                        if (!pgNumericToString(p, fl, numeric) ||
+                            !parser.parseNumeric(&numeric[0], numeric.size(), j,
+                                                 outputWriter.getNumericRef(j), outTypes.getColumnType(j), rejectReason))
+                        {
+                            PQfreemem(buf);
+                            pgErr(404, "Error parsing Numeric");
+                        }
+                        break;
+                    }
+                    case PG_BOOL:
+                        outputWriter.setBool(j, *p ? VTrue : VFalse);
+                        break;
+                    case PG_BYTES:
+                    {
+                        size_t maxlen = (size_t)outTypes.getColumnType(j).getStringLength();
+                        outputWriter.getStringRef(j).copy(p, std::min((size_t)fl, maxlen));
+                        break;
+                    }
+                    case PG_DATE: // Both PostgreSQL and Vertica count days from 2000-01-01
+                        outputWriter.setDate(j, (DateADT)pgInt32(p));
+                        break;
+                    case PG_TIME: // Microseconds since midnight
+                        outputWriter.setTime(j, (TimeADT)pgInt64(p));
+                        break;
+                    case PG_TIMESTAMP: // Both PostgreSQL and Vertica count microseconds from 2000-01-01
+                        outputWriter.setTimestamp(j, (Timestamp)pgInt64(p));
+                        break;
+                    case PG_INTERVAL_YM: // Microseconds, days, months
+                        if (pgInt64(p) != 0 || pgInt32(p + 8) != 0)
+                        {
+                            PQfreemem(buf);
+                            pgErr(405, "INTERVAL value has a day to second part. Expecting YEAR TO MONTH");
+                        }
+                        outputWriter.setInterval(j, (Interval)pgInt32(p + 12));
+                        break;
+                    case PG_INTERVAL_DS:
+                        if (pgInt32(p + 12) != 0)
+                        {
+                            PQfreemem(buf);
+                            pgErr(406, "INTERVAL value has a year to month part. Expecting DAY TO SECOND");
+                        }
+                        outputWriter.setInterval(j, (Interval)pgInt64(p) + pgInt32(p + 8) * usPerDay);
+                        break;
+                    default:
+                        PQfreemem(buf);
+                        pgErr(407, "Unsupported data type");
+                    }
+                    p += fl;
+                }
+                outputWriter.next();
+                PQfreemem(buf);
+            }
+
+            if (len == -2)
+            {
+                pgErr(506, "Error reading COPY data");
+            }
+            if (!isCanceled())
+            {
+                while ((Ores = PQgetResult(Opg)) != nullptr)
+                {
+                    if (PQresultStatus(Ores) != PGRES_COMMAND_OK)
+                    {
+                        PQclear(Ores);
+                        pgErr(506, "Error completing the COPY statement");
+                    }
+                    PQclear(Ores);
+                }
+            }
+            pgClose();
+            releaseQuery();
+            conn_slot.release();
+            return true;
+        }
+
+        // Starts a COPY ... FROM STDIN (FORMAT binary) stream and buffers its header
+        void pgBulkBegin(const std::string &copyStmt, std::string &buf)
+        {
+            PGresult *Ores = PQexec(Opg, copyStmt.c_str());
+            if (PQresultStatus(Ores) != PGRES_COPY_IN)
+            {
+                PQclear(Ores);
+                pgErr(507, "Error executing the COPY statement");
+            }
+            PQclear(Ores);
+            buf.assign(PGCOPY_SIGNATURE, sizeof(PGCOPY_SIGNATURE));
+            pgPutInt32(buf, 0); // flags
+            pgPutInt32(buf, 0); // header extension length
+        }
+
+        void pgBulkSend(std::string &buf)
+        {
+            if (!buf.empty() && PQputCopyData(Opg, buf.data(), (int)buf.size()) != 1)
+            {
+                pgErr(508, "Error sending COPY data");
+            }
+            buf.clear();
+        }
+
+        // Sends the trailer and completes (commits) the COPY stream
+        void pgBulkEnd(std::string &buf)
+        {
+            PGresult *Ores = nullptr;
+            pgPutInt16(buf, -1);
+            pgBulkSend(buf);
+            if (PQputCopyEnd(Opg, NULL) != 1)
+            {
+                pgErr(508, "Error completing the COPY statement");
+            }
+            while ((Ores = PQgetResult(Opg)) != nullptr)
+            {
+                if (PQresultStatus(Ores) != PGRES_COMMAND_OK)
+                {
+                    PQclear(Ores);
+                    pgErr(508, "Error completing the COPY statement");
+                }
+                PQclear(Ores);
+            }
+        }
+
+        // Pushes the partition into the target table through COPY ... FROM STDIN (FORMAT binary) over libpq.
+        // Returns false (without reading any row) if an input column cannot be encoded natively.
+        bool processPgBulk(ServerInterface &srvInterface, PartitionReader &inputReader, PartitionWriter &outputWriter)
+        {
+            const SizedColumnTypes &inTypes = inputReader.getTypeMetaData();
+            size_t ncol = inTypes.getColumnCount();
+            std::vector<PgCols> pgc(ncol, PG_UNSUPPORTED);
+            std::vector<int> width(ncol, 0);
+            std::string table = target;
+            std::string columns = "*";
+            std::string buf;
+            std::string field;
+            std::vector<char> numeric(MAX_NUMERIC_CHARLEN);
+            PGresult *Ores = nullptr;
+            vint loaded = 0;
+            vint pending = 0;
+
+            size_t pos = target.find('(');
+            if (pos != std::string::npos)
+            {
+                table = target.substr(0, pos);
+                columns = target.substr(pos + 1, target.rfind(')') - pos - 1);
+            }
+
+            waitSlot(srvInterface, conn_slot, "connection", gov.max_connections);
+            pgConnect();
+
+            // Describe the target columns to pick the binary encoder of every input column:
+            Ores = PQprepare(Opg, "", ("SELECT " + columns + " FROM " + table + " LIMIT 0").c_str(), 0, NULL);
+            if (PQresultStatus(Ores) != PGRES_COMMAND_OK)
+            {
+                PQclear(Ores);
+                pgErr(502, "Error describing the target table");
+            }
+            PQclear(Ores);
+            Ores = PQdescribePrepared(Opg, "");
+            if (PQresultStatus(Ores) != PGRES_COMMAND_OK)
+            {
+                PQclear(Ores);
+                pgErr(502, "Error describing the target table");
+            }
+            bool supported = ((size_t)PQnfields(Ores) == ncol);
+            for (size_t j = 0; supported && j < ncol; j++)
+            {
+                Oid oid = PQftype(Ores, (int)j);
+                const VerticaType &vt = inTypes.getColumnType(j);
+                pgc[j] = getPgCol(oid, vt);
+                width[j] = (oid == 20) ? 8 : ((oid == 21) ? 2 : 4);
+                supported = (pgc[j] != PG_UNSUPPORTED && (pgc[j] != PG_BYTES || oid != 18));
+                if (vt.isNumeric())
+                {
+                    numeric.resize(std::max(numeric.size(), (size_t)vt.getNumericPrecision() + 3));
+                }
+#ifdef DBLINK_DEBUG
+                srvInterface.log("DEBUG DBLink pgcopy target column=%zu oid=%u encoder=%d", j, oid, (int)pgc[j]);
+#endif
+            }
+            PQclear(Ores);
+            if (!supported)
+            {
+                srvInterface.log("DBLink pgcopy target table contains types without a binary encoder. Falling back to ODBC");
+                pgClose();
+                conn_slot.release();
+                return false;
+            }
+
+            // Copy loop, tuples are buffered up to PG_BULK_BUFFER bytes:
+            std::string copyStmt = "COPY " + target + " FROM STDIN (FORMAT binary)";
+            acquireQuery(srvInterface);
+            pgBulkBegin(copyStmt, buf);
+            do
+            {
+                pgPutInt16(buf, (int16_t)ncol);
+                for (size_t j = 0; j < ncol; j++)
+                {
+                    const VerticaType &vt = inTypes.getColumnType(j);
+                    if (inputReader.isNull(j))
+                    {
+                        pgPutInt32(buf, -1);
+                        continue;
+                    }
+
+                    switch (pgc[j])
+                    {
+                    case PG_INT:
+                    {
+                        vint v = inputReader.getIntRef(j);
+                        if ((width[j] == 2 && (v < INT16_MIN || v > INT16_MAX)) || (width[j] == 4 && (v < INT32_MIN || v > INT32_MAX)))
+                        {
+                            pgClose();
+                            vt_report_error(413, "DBLINK. Value %lld out of range for target column %zu", (long long)v, j);
+                        }
+                        pgPutInt32(buf, width[j]);
+                        if (width[j] == 2)
+                        {
+                            pgPutInt16(buf, (int16_t)v);
+                        }
+                        else if (width[j] == 4)
+                        {
+                            pgPutInt32(buf, (int32_t)v);
+                        }
+                        else
+                        {
+                            pgPutInt64(buf, v);
+                        }
+                        break;
+                    }
+                    case PG_FLOAT4:
+                    {
+                        float f = (float)inputReader.getFloatRef(j);
+                        int32_t v;
+                        memcpy(&v, &f, sizeof(v));
+                        pgPutInt32(buf, 4);
+                        pgPutInt32(buf, v);
+                        break;
+                    }
+                    case PG_FLOAT8:
+                    {
+                        double d = inputReader.getFloatRef(j);
+                        int64_t v;
+                        memcpy(&v, &d, sizeof(v));
+                        pgPutInt32(buf, 8);
+                        pgPutInt64(buf, v);
+                        break;
+                    }
+                    case PG_NUMERIC:
+                        inputReader.getNumericRef(j).toString(numeric.data(), numeric.size());
+                        if (!pgNumericFromString(numeric.data(), field))
+                        {
+                            pgClose();
+                            vt_report_error(413, "DBLINK. Error encoding Numeric <%s> for target column %zu", numeric.data(), j);
+                        }
+                        pgPutInt32(buf, (int32_t)field.size());
+                        buf += field;
+                        break;
+                    case PG_BOOL:
+                        pgPutInt32(buf, 1);
+                        buf += (char)(inputReader.getBoolRef(j) == VTrue ? 1 : 0);
+                        break;
+                    case PG_BYTES:
+                    {
+                        const VString &v = inputReader.getStringRef(j);
+                        pgPutInt32(buf, (int32_t)v.length());
+                        buf.append(v.data(), v.length());
+                        break;
+                    }
+                    case PG_DATE: // Both PostgreSQL and Vertica count days from 2000-01-01
+                        pgPutInt32(buf, 4);
+                        pgPutInt32(buf, (int32_t)inputReader.getDateRef(j));
+                        break;
+                    case PG_TIME:
+                        pgPutInt32(buf, 8);
+                        pgPutInt64(buf, (int64_t)inputReader.getTimeRef(j));
+                        break;
+                    case PG_TIMESTAMP:
+                        pgPutInt32(buf, 8);
+                        pgPutInt64(buf, vt.isTimestampTz() ? (int64_t)inputReader.getTimestampTzRef(j) : (int64_t)inputReader.getTimestampRef(j));
+                        break;
+                    case PG_INTERVAL_YM: // microseconds, days, months
+                        pgPutInt32(buf, 16);
+                        pgPutInt64(buf, 0);
+                        pgPutInt32(buf, 0);
+                        pgPutInt32(buf, (int32_t)inputReader.getIntervalYMRef(j));
+                        break;
+                    case PG_INTERVAL_DS:
+                        pgPutInt32(buf, 16);
+                        pgPutInt64(buf, (int64_t)inputReader.getIntervalRef(j));
+                        pgPutInt32(buf, 0);
+                        pgPutInt32(buf, 0);
+                        break;
+                    default:
+                        pgClose();
+                        vt_report_error(413, "DBLINK. Unsupported data type for input column %zu", j);
+                    }
+                }
+                loaded++;
+                pending++;
+                if (buf.size() >= PG_BULK_BUFFER)
+                {
+                    pgBulkSend(buf);
+                }
+                if (commit_size > 0 && pending >= commit_size)
+                { // each COPY statement commits on its own
+                    pgBulkEnd(buf);
+                    pgBulkBegin(copyStmt, buf);
+                    pending = 0;
+                }
+            } while (inputReader.next() && !isCanceled());
+
+            if (isCanceled())
+            {
+                (void)PQputCopyEnd(Opg, "DBLINK canceled");
+            }
+            else
+            {
+                pgBulkEnd(buf);
+                outputWriter.setInt(0, loaded);
+                outputWriter.next();
+            }
+            pgClose();
+            releaseQuery();
+            conn_slot.release();
+            return true;
+        }
+#endif
+
+        void waitSlot(ServerInterface &srvInterface, GovernorSlot &slot, const char *kind, int max)
+        {
+            long waited = slot.acquire(cid_value, kind, max, gov.priority, gov.timeout, [this]() { return isCanceled(); });
+            if (waited > 0)
+            {
+                srvInterface.log("DBLink waited %ld ms in the governor queue for a %s slot", waited, kind);
+            }
+        }
+
+        // Waits for a max_queries slot, and marks the query outstanding on its replica (replica groups)
+        void acquireQuery(ServerInterface &srvInterface)
+        {
+            waitSlot(srvInterface, query_slot, "query", gov.max_queries);
+            if (!latency_file.empty())
+            {
+                inflight.acquire(cid_value);
+            }
+        }
+
+        void releaseQuery()
+        {
+            query_slot.release();
+            inflight.release();
+        }
+
+        // Connects to cid_value. A failed SQLDriverConnect is reported, or returned as false along with its
+        // diagnostics in failure when failure is given (the handles and the connection slot are then released)
+        bool connect(ServerInterface &srvInterface, std::string *failure = nullptr)
+        {
+            SQLCHAR Obuff[64];
+            SQLRETURN Oret = 0;
+
+            // ODBC Connection:
+            if (!SQL_SUCCEEDED(Oret = SQLAllocHandle(SQL_HANDLE_ENV, (SQLHANDLE)SQL_NULL_HANDLE, &Oenv)))
+            {
+                ex_err(0, 0, 107, "Error allocating Environment Handle", Ost, Ocon, Oenv);
+            }
+            if (!SQL_SUCCEEDED(Oret = SQLSetEnvAttr(Oenv, SQL_ATTR_ODBC_VERSION, (void *)SQL_OV_ODBC3, 0)))
+            {
+                ex_err(0, 0, 108, "Error setting SQL_OV_ODBC3", Ost, Ocon, Oenv);
+            }
+            if (!SQL_SUCCEEDED(Oret = SQLAllocHandle(SQL_HANDLE_DBC, Oenv, &Ocon)))
+            {
+                ex_err(0, 0, 109, "Error allocating Connection Handle", Ost, Ocon, Oenv);
+            }
+            waitSlot(srvInterface, conn_slot, "connection", gov.max_connections);
+            DBLINK_PROBE(connect_start);
+            int64_t start = trace.now();
+            Oret = SQLDriverConnect(Ocon, (SQLHWND)NULL, (SQLCHAR *)cid_value.c_str(), SQL_NTS, NULL, 0, NULL, SQL_DRIVER_NOPROMPT);
+            DBLINK_PROBE1(connect_done, (int)Oret);
+            if (!SQL_SUCCEEDED(Oret) && failure)
+            {
+                *failure = diagText(SQL_HANDLE_DBC, Ocon);
+                clean(Ost, Ocon, Oenv);
+                conn_slot.release();
+                return false;
+            }
+            if (!SQL_SUCCEEDED(Oret))
+            {
+                ex_err(SQL_HANDLE_DBC, Ocon, 110, "Error connecting to target database", Ost, Ocon, Oenv);
+            }
+
+            // ODBC Statement preparation:
+            if (!SQL_SUCCEEDED(Oret = SQLAllocHandle(SQL_HANDLE_STMT, Ocon, &Ost)))
+            {
+                ex_err(SQL_HANDLE_DBC, Ocon, 111, "Error allocating Statement Handle", Ost, Ocon, Oenv);
+            }
+
+            // Check the DBMS we are connecting to:
+            if (!SQL_SUCCEEDED(Oret = SQLGetInfo(Ocon, SQL_DBMS_NAME,
+                                                 (SQLPOINTER)Obuff, (SQLSMALLINT)sizeof(Obuff), NULL)))
+            {
+                ex_err(SQL_HANDLE_DBC, Ocon, 202, "Error getting remote DBMS Name", Ost, Ocon, Oenv);
+            }
+            dbt = getDbType((char *)Obuff);
+            trace.span("connect", start, "\"dbms\":\"%s\"", (char *)Obuff);
+            memset(&Obuff[0], 0, sizeof(Obuff));
+            prepared = false;
+            return true;
+        }
+
+        // SQLExecute between the execute_start/execute_done probes
+        SQLRETURN executeStatement()
+        {
+            DBLINK_PROBE(execute_start);
+            int64_t start = trace.now();
+            SQLRETURN Oret = SQLExecute(Ost);
+            DBLINK_PROBE1(execute_done, (int)Oret);
+            trace.span("execute", start, "\"ret\":%d", (int)Oret);
+            return Oret;
+        }
+
+        // Fetches the next rowset between the fetch_start/fetch_done probes (rowset number, rows fetched)
+        SQLRETURN fetchRowset()
+        {
+            nfetch++;
+            DBLINK_PROBE1(fetch_start, nfetch);
+            int64_t start = trace.now();
+            SQLRETURN Oret = direct.active() ? direct.fetch() : SQLFetchScroll(Ost, SQL_FETCH_NEXT, 0);
+            if (hedge.pending() && (hedged = hedge.settle()))
+            { // the primary was canceled, the rowsets come from the hedged replica
+                Oret = SQL_NO_DATA;
+            }
+            unsigned long rows = SQL_SUCCEEDED(Oret) ? (unsigned long)nfr : 0;
+            DBLINK_PROBE2(fetch_done, nfetch, rows);
+            trace.span("fetch", start, "\"rowset\":%lu,\"rows\":%lu", nfetch, rows);
+            return Oret;
+        }
+
+        // Adopts the connection and statement the factory parked for this query, if they are still there. In a
+        // replica group, the query then runs on the member the factory was routed to
+        bool adoptHandoff(ServerInterface &srvInterface)
+        {
+            std::unique_ptr<Handoff> h = HandoffRegistry::instance().claim(HandoffRegistry::key(replicas, cid_value, query));
+            if (!h)
+            {
+                return false;
+            }
+            std::swap(Oenv, h->Oenv);
+            std::swap(Ocon, h->Ocon);
+            std::swap(Ost, h->Ost);
+            conn_slot.take(h->conn_slot);
+            dbt = h->dbt;
+            if (h->member != cid_value)
+            {
+                auto it = std::find(replicas.begin(), replicas.end(), h->member);
+                if (it != replicas.end())
+                {
+                    std::rotate(replicas.begin(), it, it + 1);
+                }
+                cid_value = h->member;
+            }
+            adopted = true;
+            prepared = false;
+            srvInterface.log("DBLink adopted the statement prepared while planning");
+            return true;
+        }
+
+        // Rowset buffer of column j, allocated on the first prepare
+        SQLPOINTER columnBuffer(ServerInterface &srvInterface, size_t j)
+        {
+            if (!Ores[j])
+            {
+                Ores[j] = (SQLPOINTER)srvInterface.allocator->alloc(desz[j] * rowset);
+            }
+            return Ores[j];
+        }
+
+        // True if the last call on the statement failed transiently, and the extraction can resume after it
+        bool retryable()
+        {
+            std::string diag;
+            return resume.enabled() && isTransientError(Ost, diag);
+        }
+
+        // Prepares the statement, allocates the result set buffers and binds them. Done once per instance,
+        // and again on a new connection when a resumable extraction recovers from a failure. Returns false,
+        // with the statement diagnostics kept for resumeAfterError(), when a call reaching the remote database
+        // fails transiently in a resumable extraction
+        bool prepare(ServerInterface &srvInterface, const SizedColumnTypes &outTypes)
+        {
+            SQLSMALLINT Onamel = 0;
+            SQLSMALLINT Onull = 0;
+            SQLCHAR Ocname[MAXCNAMELEN];
+            SQLRETURN Oret = 0;
+
+            DBLINK_PROBE(prepare_start);
+            int64_t start = trace.now();
+            if (!adopted && !SQL_SUCCEEDED(Oret = SQLPrepare(Ost, (SQLCHAR *)query.c_str(), SQL_NTS)))
+            {
+                if (retryable())
+                {
+                    return false;
+                }
+                ex_err(SQL_HANDLE_STMT, Ost, 112, "Error preparing the statement", Ost, Ocon, Oenv);
+            }
+            adopted = false;
+            if (watermark.hasMark() && !SQL_SUCCEEDED(Oret = watermark.bind(Ost)))
+            {
+                ex_err(SQL_HANDLE_STMT, Ost, 411, "Error binding the watermark", Ost, Ocon, Oenv);
+            }
+            if (resume.hasMark() && !SQL_SUCCEEDED(Oret = resume.bind(Ost)))
+            {
+                ex_err(SQL_HANDLE_STMT, Ost, 415, "Error binding the resume key", Ost, Ocon, Oenv);
+            }
+            if (!SQL_SUCCEEDED(Oret = SQLNumResultCols(Ost, (SQLSMALLINT *)&Oncol)))
+            {
+                if (retryable())
+                {
+                    return false;
+                }
+                ex_err(SQL_HANDLE_STMT, Ost, 115, "Error finding the number of resulting columns", Ost, Ocon, Oenv);
+            }
+            bool declared = parquet_path.empty(); // the output columns are the result set columns
+            if (declared && (size_t)Oncol != outTypes.getColumnCount())
+            {
+                ex_err(0, 0, 410, "Remote result set does not match the output columns", Ost, Ocon, Oenv);
+            }
+
+            // Drivers that run the query to describe it are executed first and described from the open cursor:
+            if (describeExecutes(dbt) && !executed)
+            {
+                if (!SQL_SUCCEEDED(Oret = executeStatement()) && Oret != SQL_NO_DATA)
+                {
+                    if (retryable())
+                    {
+                        return false;
+                    }
+                    ex_err(SQL_HANDLE_STMT, Ost, 403, "Error executing the statement", Ost, Ocon, Oenv);
+                }
+                executed = true;
+            }
+
+            Odt.assign((size_t)Oncol, 0);
+            desz.assign((size_t)Oncol, 0);
+            narrowed.clear();
+            parquet_cols.clear();
+
+            std::unique_ptr<SQLULEN[], decltype(&free)> Ors(static_cast<SQLULEN *>(calloc((size_t)Oncol, sizeof(SQLULEN))), std::free);
+            if (Ors.get() == nullptr)
+            {
+                ex_err(0, 0, 117, "Error allocating result set columns size array", Ost, Ocon, Oenv);
+            }
+
+            std::unique_ptr<SQLSMALLINT[], decltype(&free)> Odd(static_cast<SQLSMALLINT *>(calloc((size_t)Oncol, sizeof(SQLSMALLINT))), std::free);
+            if (Odd.get() == nullptr)
+            {
+                ex_err(0, 0, 119, "Error allocating result set decimal size array", Ost, Ocon, Oenv);
+            }
+
+            // Allocate memory for Result Set and length array pointers:
+            // (kept when the statement is prepared again to resume the extraction)
+            if (!Ores)
+            {
+                Ores = (SQLPOINTER *)srvInterface.allocator->alloc(Oncol * sizeof(SQLPOINTER));
+                Olen = (SQLLEN **)srvInterface.allocator->alloc(Oncol * sizeof(SQLLEN *));
+                memset(Ores, 0, Oncol * sizeof(SQLPOINTER));
+                memset(Olen, 0, Oncol * sizeof(SQLLEN *));
+            }
+#ifdef DBLINK_DEBUG
+            srvInterface.log("DEBUG DBLink num_col=%d allocated size Ores=%lu Olen=%lu", Oncol, malloc_usable_size(Ores), malloc_usable_size(Olen));
+#endif
+
+            // Allocate space for each column and bind it:
+            cnames.clear();
+            for (unsigned int j = 0; j < Oncol; j++)
+            {
+                SQLLEN Ool = 0;
+                if (!SQL_SUCCEEDED(Oret = SQLDescribeCol(Ost, (SQLUSMALLINT)(j + 1),
+                                                         Ocname, (SQLSMALLINT)MAXCNAMELEN, &Onamel,
+                                                         &Odt[j], &Ors[j], &Odd[j], &Onull)))
+                {
+                    ex_err(SQL_HANDLE_STMT, Ost, 120, "Error getting column description", Ost, Ocon, Oenv);
+                }
+                cnames.push_back((char *)Ocname);
+                std::transform(cnames.back().begin(), cnames.back().end(), cnames.back().begin(), ::tolower);
+#ifdef DBLINK_DEBUG
+                srvInterface.log("DEBUG DBLink SQLDescribeCol src column=%u name=%s data_type=%d length=%zu", j, (char *)Ocname, Odt[j], Ors[j]);
+#endif
+                if (watermark.enabled() && !strcasecmp((char *)Ocname, watermark.column.c_str()))
+                {
+                    wm_idx = (int)j;
+                    if ((wm_kind = Watermark::kindOf(Odt[j])) == WM_NONE)
+                    {
+                        ex_err(0, 0, 411, "Unsupported data type for the watermark column", Ost, Ocon, Oenv);
+                    }
+                    watermark.digits = std::min(std::max((int)Odd[j], 0), 9);
+                }
+                if (resume.enabled() && !strcasecmp((char *)Ocname, resume.column.c_str()))
+                {
+                    rs_idx = (int)j;
+                    if ((rs_kind = Watermark::kindOf(Odt[j])) == WM_NONE)
+                    {
+                        ex_err(0, 0, 415, "Unsupported data type for the resume key column", Ost, Ocon, Oenv);
+                    }
+                    resume.digits = std::min(std::max((int)Odd[j], 0), 9);
+                }
+                if (!declared)
+                {
+                    parquet_cols.push_back(parquetColumn((char *)Ocname, Odt[j], Ors[j], Odd[j]));
+                }
+                else if (!isCompatibleType(Odt[j], outTypes.getColumnType(j)))
+                {
+                    vt_report_error(410, "DBLink. Remote column %s (ODBC type %d) does not match output column type %s",
+                                    (char *)Ocname, Odt[j], outTypes.getColumnType(j).getPrettyPrintStr().c_str());
+                }
+
+                if (!Olen[j])
+                {
+                    Olen[j] = (SQLLEN *)srvInterface.allocator->alloc(sizeof(SQLLEN) * rowset);
+                }
+                if (isStringType(Odt[j]))
+                {
+                    if (!SQL_SUCCEEDED(Oret = SQLColAttribute(Ost, (SQLUSMALLINT)(j + 1), SQL_DESC_OCTET_LENGTH,
+                                                              (SQLPOINTER)NULL, (SQLSMALLINT)0, (SQLSMALLINT *)NULL, &Ool)))
+                    {
+                        ex_err(SQL_HANDLE_STMT, Ost, 120, "Error getting column description", Ost, Ocon, Oenv);
+                    }
+#ifdef DBLINK_DEBUG
+                    srvInterface.log("DEBUG DBLink SQLColAttribute SQL_DESC_OCTET_LENGTH src column=%u name=%s data_type=%d length=%ld", j, (char *)Ocname, Odt[j], Ool);
+#endif
+                }
+
+                // Size the buffer as the factory declared the column (schema or observed width included):
+                ColumnPlan plan;
+                SQLULEN width = 0;
+                if (declared && (isStringType(Odt[j]) || bindCType(dbt, Odt[j]) == SQL_C_BINARY))
+                {
+                    width = (SQLULEN)outTypes.getColumnType(j).getStringLength();
+                }
+                if (!planColumn(dbt, Odt[j], Ors[j], Ool, Odd[j], width, plan))
+                {
+                    vt_report_error(121, "DBLink. Unsupported data type for column %u", j);
+                }
+                if (!width_file.empty() && isStringType(Odt[j]) && plan.length < plan.remote)
+                {
+                    narrowed.push_back({(size_t)j, plan.remote});
+                }
+                if (isStringType(Odt[j]) && !plan.note.empty())
+                {
+                    srvInterface.log("DBLink column %s: %s", (char *)Ocname, plan.note.c_str());
+                }
+                desz[j] = plan.desz;
+                Ores[j] = columnBuffer(srvInterface, j);
+                if (!SQL_SUCCEEDED(Oret = SQLBindCol(Ost, j + 1, plan.Octype, Ores[j], desz[j], Olen[j])))
+                {
+                    ex_err(SQL_HANDLE_STMT, Ost, 401, "Error binding column", Ost, Ocon, Oenv);
+                }
+            }
+#ifdef DBLINK_DEBUG
+            srvInterface.log("DEBUG DBLink Allocation and Binding were completed");
+#endif
+
+            if (watermark.enabled() && wm_idx < 0)
+            {
+                vt_report_error(411, "DBLink. Watermark column %s not found in the result set", watermark.column.c_str());
+            }
+            if (resume.enabled() && rs_idx < 0)
+            {
+                vt_report_error(415, "DBLink. Resume key column %s not found in the result set", resume.column.c_str());
+            }
+
+            // Set Statement attributes:
+            if (!SQL_SUCCEEDED(Oret = SQLSetStmtAttr(Ost, SQL_ATTR_ROW_BIND_TYPE, (SQLPOINTER)SQL_BIND_BY_COLUMN, 0)))
+            {
+                ex_err(SQL_HANDLE_STMT, Ost, 402, "Error setting statement attribute SQL_ATTR_ROW_BIND_TYPE", Ost, Ocon, Oenv);
+            }
+            if (!SQL_SUCCEEDED(Oret = SQLSetStmtAttr(Ost, SQL_ATTR_ROW_ARRAY_SIZE, (SQLPOINTER)rowset, 0)))
+            {
+                ex_err(SQL_HANDLE_STMT, Ost, 402, "Error setting statement attribute SQL_ATTR_ROW_ARRAY_SIZE", Ost, Ocon, Oenv);
+            }
+            if (!SQL_SUCCEEDED(Oret = SQLSetStmtAttr(Ost, SQL_ATTR_ROWS_FETCHED_PTR, &nfr, 0)))
+            {
+                ex_err(SQL_HANDLE_STMT, Ost, 402, "Error setting statement attribute SQL_ATTR_ROWS_FETCHED_PTR", Ost, Ocon, Oenv);
+            }
+#ifdef DBLINK_DEBUG
+            srvInterface.log("DEBUG DBLink Setting attributes were completed");
+#endif
+
+            // Wide result sets are converted column by column on the worker pool (straight into the pages with parquet_path):
+            if (workers > 1 && Oncol > 1 && !pool)
+            {
+                if (parquet_path.empty())
+                {
+                    staged = (StagedValue *)srvInterface.allocator->alloc(sizeof(StagedValue) * Oncol * rowset);
+                }
+                pool.reset(new ConvertPool(std::min(workers, (size_t)Oncol)));
+            }
+
+            // Resolve the driver entry points once the statement is bound, or keep fetching through the driver manager:
+            std::string why;
+            if (direct_fetch && !direct.open(Ocon, Ost, why))
+            {
+                srvInterface.log("DBLink direct_fetch unavailable (%s), fetching through the driver manager", why.c_str());
+            }
+            prepared = true;
+            DBLINK_PROBE1(prepare_done, (int)Oncol);
+            trace.span("prepare", start, "\"columns\":%d", (int)Oncol);
+            return true;
+        }
+
+        // Prepares the INSERT into the target table and binds the parameter arrays (rowset rows per execution)
+        void prepareBulk(ServerInterface &srvInterface, const SizedColumnTypes &inTypes)
+        {
+            SQLRETURN Oret = 0;
+            std::string insert = "INSERT INTO " + target + " VALUES (";
+
+            Oncol = (SQLUSMALLINT)inTypes.getColumnCount();
+            for (size_t j = 0; j < Oncol; j++)
+            {
+                insert += (j ? ", ?" : "?");
+            }
+            insert += ")";
+#ifdef DBLINK_DEBUG
+            srvInterface.log("DEBUG DBLink bulk statement <%s>", insert.c_str());
+#endif
+
+            // Commits are driven by commit_size:
+            if (!SQL_SUCCEEDED(Oret = SQLSetConnectAttr(Ocon, SQL_ATTR_AUTOCOMMIT, (SQLPOINTER)SQL_AUTOCOMMIT_OFF, 0)))
+            {
+                ex_err(SQL_HANDLE_DBC, Ocon, 412, "Error disabling autocommit", Ost, Ocon, Oenv);
+            }
+            if (!SQL_SUCCEEDED(Oret = SQLPrepare(Ost, (SQLCHAR *)insert.c_str(), SQL_NTS)))
+            {
+                ex_err(SQL_HANDLE_STMT, Ost, 412, "Error preparing the INSERT statement", Ost, Ocon, Oenv);
+            }
+
+            Ores = (SQLPOINTER *)srvInterface.allocator->alloc(Oncol * sizeof(SQLPOINTER));
+            Olen = (SQLLEN **)srvInterface.allocator->alloc(Oncol * sizeof(SQLLEN *));
+            Opst = (SQLUSMALLINT *)srvInterface.allocator->alloc(rowset * sizeof(SQLUSMALLINT));
+            desz.assign(Oncol, 0);
+            for (SQLUSMALLINT j = 0; j < Oncol; j++)
+            {
+                SQLSMALLINT Oct = 0;
+                SQLSMALLINT Opt = 0;
+                SQLULEN Ocs = 0;
+                SQLSMALLINT Odd = 0;
+                if (!getBulkParam(inTypes.getColumnType(j), Oct, Opt, Ocs, Odd, desz[j]))
+                {
+                    vt_report_error(413, "DBLINK. Unsupported data type for input column %u", j);
+                }
+                Ores[j] = (SQLPOINTER)srvInterface.allocator->alloc(desz[j] * rowset);
+                Olen[j] = (SQLLEN *)srvInterface.allocator->alloc(sizeof(SQLLEN) * rowset);
+                if (!SQL_SUCCEEDED(Oret = SQLBindParameter(Ost, j + 1, SQL_PARAM_INPUT, Oct, Opt, Ocs, Odd, Ores[j], (SQLLEN)desz[j], Olen[j])))
+                {
+                    ex_err(SQL_HANDLE_STMT, Ost, 412, "Error binding parameter", Ost, Ocon, Oenv);
+                }
+            }
+
+            if (!SQL_SUCCEEDED(Oret = SQLSetStmtAttr(Ost, SQL_ATTR_PARAM_BIND_TYPE, (SQLPOINTER)SQL_PARAM_BIND_BY_COLUMN, 0)) ||
+                !SQL_SUCCEEDED(Oret = SQLSetStmtAttr(Ost, SQL_ATTR_PARAM_STATUS_PTR, (SQLPOINTER)Opst, 0)) ||
+                !SQL_SUCCEEDED(Oret = SQLSetStmtAttr(Ost, SQL_ATTR_PARAMS_PROCESSED_PTR, (SQLPOINTER)&nfr, 0)))
+            {
+                ex_err(SQL_HANDLE_STMT, Ost, 412, "Error setting parameter array attributes", Ost, Ocon, Oenv);
+            }
+            prepared = true;
+        }
+
+        // Copies the current input row into element i of the parameter arrays
+        void bindBulkRow(PartitionReader &inputReader, const SizedColumnTypes &inTypes, size_t i)
+        {
+            for (size_t j = 0; j < Oncol; j++)
+            {
+                readParamValue(inputReader, inTypes.getColumnType(j), j, (SQLPOINTER)((uint8_t *)Ores[j] + desz[j] * i), desz[j], Olen[j][i]);
+            }
+        }
+
+        // Executes the INSERT for the n bound rows and commits every commit_size rows
+        void flushBulk(SQLULEN n, vint &loaded, vint &pending)
+        {
+            SQLRETURN Oret = 0;
+            size_t rejected = 0;
+
+            if (!SQL_SUCCEEDED(Oret = SQLSetStmtAttr(Ost, SQL_ATTR_PARAMSET_SIZE, (SQLPOINTER)n, 0)))
+            {
+                ex_err(SQL_HANDLE_STMT, Ost, 412, "Error setting the parameter array size", Ost, Ocon, Oenv);
+            }
+            if (!SQL_SUCCEEDED(Oret = executeStatement()) && Oret != SQL_NO_DATA)
+            {
+                ex_err(SQL_HANDLE_STMT, Ost, 412, "Error inserting into the target table", Ost, Ocon, Oenv);
+            }
+            for (SQLULEN i = 0; i < nfr; i++)
+            {
+                rejected += (Opst[i] == SQL_PARAM_ERROR);
+            }
+            if (rejected)
+            {
+                clean(Ost, Ocon, Oenv);
+                vt_report_error(412, "DBLINK. Error inserting into the target table. %zu rows rejected", rejected);
+            }
+            loaded += (vint)n;
+            pending += (vint)n;
+            if (commit_size > 0 && pending >= commit_size)
+            {
+                if (!SQL_SUCCEEDED(Oret = SQLEndTran(SQL_HANDLE_DBC, Ocon, SQL_COMMIT)))
+                {
+                    ex_err(SQL_HANDLE_DBC, Ocon, 414, "Error committing the target rows", Ost, Ocon, Oenv);
+                }
+                pending = 0;
+            }
+        }
+
+        // Pushes the partition into the target table through array bound INSERTs
+        void processBulk(ServerInterface &srvInterface, PartitionReader &inputReader, PartitionWriter &outputWriter)
+        {
+            const SizedColumnTypes &inTypes = inputReader.getTypeMetaData();
+            SQLRETURN Oret = 0;
+            size_t n = 0;
+            vint loaded = 0;
+            vint pending = 0;
+
+            if (!prepared)
+            {
+                prepareBulk(srvInterface, inTypes);
+            }
+            acquireQuery(srvInterface);
+            do
+            {
+                bindBulkRow(inputReader, inTypes, n);
+                if (++n == rowset)
+                {
+                    flushBulk((SQLULEN)n, loaded, pending);
+                    n = 0;
+                }
+            } while (inputReader.next() && !isCanceled());
+
+            if (isCanceled())
+            {
+                (void)SQLEndTran(SQL_HANDLE_DBC, Ocon, SQL_ROLLBACK);
+                releaseQuery();
+                return;
+            }
+            if (n)
+            {
+                flushBulk((SQLULEN)n, loaded, pending);
+            }
+            if (pending && !SQL_SUCCEEDED(Oret = SQLEndTran(SQL_HANDLE_DBC, Ocon, SQL_COMMIT)))
+            {
+                ex_err(SQL_HANDLE_DBC, Ocon, 414, "Error committing the target rows", Ost, Ocon, Oenv);
+            }
+            releaseQuery();
+#ifdef DBLINK_DEBUG
+            srvInterface.log("DEBUG DBLink bulk rows inserted=%lld", (long long)loaded);
+#endif
+            outputWriter.setInt(0, loaded);
+            outputWriter.next();
+        }
+
+        // Semi-join pushdown: runs the query restricted to the distinct keys of the input column, FILTER_KEYS keys
+        // per execution. The last IN-list is padded with its last key, so the statement is prepared only once
+        void processFilter(ServerInterface &srvInterface, PartitionReader &inputReader, PartitionWriter &outputWriter)
+        {
+            const VerticaType &vt = inputReader.getTypeMetaData().getColumnType(0);
+            OutputColumnWriter out(outputWriter);
+            std::unordered_set<std::string> seen;
+            SQLRETURN Oret = 0;
+            size_t n = 0;
+
+            // Bind the IN-list parameters (they keep their buffers when the statement is prepared):
+            if (!Okey)
+            {
+                SQLSMALLINT Oct = 0;
+                SQLSMALLINT Opt = 0;
+                SQLULEN Ocs = 0;
+                SQLSMALLINT Odd = 0;
+                (void)getBulkParam(vt, Oct, Opt, Ocs, Odd, keysz);
+                Okey = (SQLPOINTER)srvInterface.allocator->alloc(keysz * FILTER_KEYS);
+                Okeylen = (SQLLEN *)srvInterface.allocator->alloc(sizeof(SQLLEN) * FILTER_KEYS);
+                for (size_t k = 0; k < FILTER_KEYS; k++)
+                {
+                    if (!SQL_SUCCEEDED(Oret = SQLBindParameter(Ost, (SQLUSMALLINT)(k + 1), SQL_PARAM_INPUT, Oct, Opt, Ocs, Odd,
+                                                               (SQLPOINTER)((uint8_t *)Okey + keysz * k), (SQLLEN)keysz, &Okeylen[k])))
+                    {
+                        ex_err(SQL_HANDLE_STMT, Ost, 416, "Error binding the filter keys", Ost, Ocon, Oenv);
+                    }
+                }
+            }
+
+            acquireQuery(srvInterface);
+            bool more = true;
+            while (more && !isCanceled())
+            {
+                SQLPOINTER Odp = (SQLPOINTER)((uint8_t *)Okey + keysz * n);
+                readParamValue(inputReader, vt, 0, Odp, keysz, Okeylen[n]);
+                more = inputReader.next();
+                if (Okeylen[n] != SQL_NULL_DATA &&
+                    seen.insert(std::string((char *)Odp, Okeylen[n] == SQL_NTS ? strlen((char *)Odp) : (size_t)Okeylen[n])).second)
+                {
+                    n++;
+                }
+                if (n == 0 || (n < FILTER_KEYS && more))
+                {
+                    continue;
+                }
+                for (size_t k = n; k < FILTER_KEYS; k++)
+                { // pad the last IN-list
+                    memcpy((uint8_t *)Okey + keysz * k, (uint8_t *)Okey + keysz * (n - 1), keysz);
+                    Okeylen[k] = Okeylen[n - 1];
+                }
+                n = 0;
+
+                // prepare() may execute the statement, once the first keys are bound
+                if (!prepared)
+                {
+                    prepare(srvInterface, outputWriter.getTypeMetaData());
+                }
+                if (!executed && !SQL_SUCCEEDED(Oret = executeStatement()) && Oret != SQL_NO_DATA)
+                {
+                    ex_err(SQL_HANDLE_STMT, Ost, 403, "Error executing the statement", Ost, Ocon, Oenv);
+                }
+                executed = false;
+                while (SQL_SUCCEEDED(Oret = fetchRowset()) && !isCanceled())
+                {
+                    convertRowset(out, outputWriter);
+                }
+                if (Oret == SQL_ERROR && direct.active())
+                {
+                    srvInterface.log("DBLink direct fetch error: %s", direct.diag().c_str());
+                }
+                if (Oret == SQL_ERROR)
+                {
+                    ex_err(SQL_HANDLE_STMT, Ost, 416, "Error fetching rows", Ost, Ocon, Oenv);
+                }
+                if (!SQL_SUCCEEDED(Oret = SQLFreeStmt(Ost, SQL_CLOSE)))
+                {
+                    ex_err(SQL_HANDLE_STMT, Ost, 409, "Error closing the cursor", Ost, Ocon, Oenv);
+                }
+            }
+            releaseQuery();
+#ifdef DBLINK_DEBUG
+            srvInterface.log("DEBUG DBLink filter keys=%zu", seen.size());
+#endif
+        }
+
+        // Runs a catalog query of the remote Vertica and returns the first ncol columns of its rows
+        void selectCatalog(const std::string &sql, SQLSMALLINT ncol, std::vector<std::vector<std::string>> &rows)
+        {
+            SQLHSTMT Osst = nullptr;
+            SQLRETURN Oret = 0;
+            SQLCHAR Obuff[MAX_DSN_VALUE_LEN];
+            SQLLEN Oind = 0;
+
+            if (!SQL_SUCCEEDED(Oret = SQLAllocHandle(SQL_HANDLE_STMT, Ocon, &Osst)))
+            {
+                ex_err(SQL_HANDLE_DBC, Ocon, 418, "Error allocating Statement Handle", Ost, Ocon, Oenv);
+            }
+            if (!SQL_SUCCEEDED(Oret = SQLExecDirect(Osst, (SQLCHAR *)sql.c_str(), SQL_NTS)))
+            {
+                std::string diag = diagText(SQL_HANDLE_STMT, Osst);
+                (void)SQLFreeHandle(SQL_HANDLE_STMT, Osst);
+                clean(Ost, Ocon, Oenv);
+                vt_report_error(418, "DBLink. Error reading the segmentation of %s. %s", segment_table.c_str(), diag.c_str());
+            }
+            while (SQL_SUCCEEDED(Oret = SQLFetch(Osst)))
+            {
+                rows.emplace_back();
+                for (SQLSMALLINT c = 1; c <= ncol; c++)
+                {
+                    if (!SQL_SUCCEEDED(SQLGetData(Osst, (SQLUSMALLINT)c, SQL_C_CHAR, Obuff, (SQLLEN)sizeof(Obuff), &Oind)) || Oind == SQL_NULL_DATA)
+                    {
+                        Obuff[0] = '\0';
+                    }
+                    rows.back().push_back((char *)Obuff);
+                }
+            }
+            (void)SQLFreeHandle(SQL_HANDLE_STMT, Osst);
+        }
+
+        // Looks up the segmentation expression of segment_table and the UP nodes, as name, address and the bounds of
+        // the hash range the node stores. False when the table has no segmented projection or the cluster a single node up
+        bool discoverSegments(ServerInterface &srvInterface, std::string &expr, std::vector<std::vector<std::string>> &nodes)
+        {
+            std::string schema = "public";
+            std::string table = segment_table;
+            std::vector<std::vector<std::string>> rows;
+            std::vector<std::vector<std::string>> bounds; // node name, lowest bound of its containers
+            std::map<std::string, std::string> lower;
+
+            size_t dot = table.find('.');
+            if (dot != std::string::npos)
+            {
+                schema = table.substr(0, dot);
+                table = table.substr(dot + 1);
+            }
+            selectCatalog("SELECT segment_expression, projection_name FROM v_catalog.projections WHERE is_segmented AND projection_schema ILIKE " + sqlLiteral(schema) +
+                              " AND anchor_table_name ILIKE " + sqlLiteral(table) + " ORDER BY is_super_projection DESC, projection_name LIMIT 1",
+                          2, rows);
+            if (rows.empty() || rows[0][0].empty())
+            {
+                srvInterface.log("DBLink %s has no segmented projection, the query is read through one connection", segment_table.c_str());
+                return false;
+            }
+            expr = unqualify(rows[0][0], table);
+            for (auto &col : exprColumns(expr))
+            { // the ranges filter the result set of the query, which must return the segmentation columns
+                if (std::find(cnames.begin(), cnames.end(), col) == cnames.end())
+                {
+                    srvInterface.log("DBLink segmentation column %s of %s is not in the SELECT list, the query is read through one connection",
+                                     col.c_str(), segment_table.c_str());
+                    return false;
+                }
+            }
+            selectCatalog("SELECT node_name, node_address FROM v_catalog.nodes WHERE node_state = 'UP' ORDER BY node_name", 2, nodes);
+            if (nodes.size() < 2)
+            {
+                srvInterface.log("DBLink remote cluster has %zu node up, the query is read through one connection", nodes.size());
+                return false;
+            }
+
+            // Each node reads the hash range its containers of the projection store, from its lowest bound to the next node's:
+            selectCatalog("SELECT node_name, MIN(segment_lower_bound) FROM v_monitor.storage_containers WHERE schema_name ILIKE " + sqlLiteral(schema) +
+                              " AND projection_name = " + sqlLiteral(rows[0][1]) + " GROUP BY node_name",
+                          2, bounds);
+            for (auto &b : bounds)
+            {
+                if (!b[1].empty())
+                {
+                    lower[b[0]] = b[1];
+                }
+            }
+            bool located = std::all_of(nodes.begin(), nodes.end(), [&lower](const std::vector<std::string> &n) { return lower.count(n[0]) > 0; });
+            if (located)
+            {
+                std::sort(nodes.begin(), nodes.end(), [&lower](const std::vector<std::string> &x, const std::vector<std::string> &y)
+                          { return strtoull(lower[x[0]].c_str(), NULL, 10) < strtoull(lower[y[0]].c_str(), NULL, 10); });
+            }
+            else
+            { // e.g. no data on a node yet: equal ranges of the hash values, in [0, 2^63)
+                srvInterface.log("DBLink %s has no storage on every node up, its hash range is split in equal ranges", segment_table.c_str());
+            }
+            uint64_t step = ((uint64_t)1 << 63) / nodes.size();
+            for (size_t k = 0; k < nodes.size(); k++)
+            { // the first and last ranges are open so that every row is read once whatever the hash values
+                nodes[k].push_back(k == 0 ? "" : located ? lower[nodes[k][0]] : std::to_string(step * k));
+                nodes[k].push_back(k + 1 == nodes.size() ? "" : located ? lower[nodes[k + 1][0]] : std::to_string(step * (k + 1)));
+            }
+            return true;
+        }
+
+        // Reads the query through one connection per remote Vertica node (load balancing off), each restricted to
+        // the hash range of its node, and converts the rowsets of the streams as they are fetched. The queries all
+        // read the last closed epoch. False when the query has to be read through the instance connection instead
+        bool processSegments(ServerInterface &srvInterface, PartitionWriter &outputWriter)
+        {
+            OutputColumnWriter out(outputWriter);
+            std::string expr;
+            std::vector<std::vector<std::string>> nodes; // name, address, lower and upper bounds
+            std::vector<std::vector<std::string>> epoch;
+            size_t rows = 0;
+
+            if (dbt != VERTICA)
+            {
+                clean(Ost, Ocon, Oenv);
+                vt_report_error(418, "DBLink. Error segment_table requires a Vertica remote database");
+            }
+            if (!prepared)
+            { // describes the result set and allocates the instance buffers
+                prepare(srvInterface, outputWriter.getTypeMetaData());
+            }
+            if (!discoverSegments(srvInterface, expr, nodes))
+            {
+                return false;
+            }
+            selectCatalog("SELECT GET_CURRENT_EPOCH() - 1", 1, epoch);
+            if (epoch.empty() || epoch[0][0].empty())
+            {
+                clean(Ost, Ocon, Oenv);
+                vt_report_error(418, "DBLink. Error reading the current epoch of the remote database");
+            }
+            srvInterface.log("DBLink reading %zu segments of %s by %s at epoch %s", nodes.size(), segment_table.c_str(), expr.c_str(), epoch[0][0].c_str());
+
+            for (size_t k = 0; k < nodes.size(); k++)
+            {
+                RowsetStream &s = segments.add(nodes[k][0], nodeConnectString(cid_value, nodes[k][1]), segmentQuery(query, expr, nodes[k][2], nodes[k][3], epoch[0][0]));
+                waitSlot(srvInterface, s.slot, "connection", gov.max_connections);
+                waitSlot(srvInterface, s.query_slot, "query", gov.max_queries);
+#ifdef DBLINK_DEBUG
+                srvInterface.log("DEBUG DBLink segment %s <%s>", s.node.c_str(), s.query.c_str());
+#endif
+            }
+            segments.start(bindTypes(), desz, rowset);
+            rows = drainStreams(segments, out, outputWriter, 418, "segment of node");
+            srvInterface.log("DBLink read %zu rows from %zu segments", rows, nodes.size());
+            return true;
+        }
+
+        // C types the result set columns were bound as by prepare()
+        std::vector<SQLSMALLINT> bindTypes()
+        {
+            std::vector<SQLSMALLINT> Octype;
+            for (size_t j = 0; j < Oncol; j++)
+            {
+                Octype.push_back(bindCType(dbt, Odt[j]));
+            }
+            return Octype;
+        }
+
+        // Converts the rowsets of the pull streams, from their own buffers, as they are fetched. Returns the rows
+        size_t drainStreams(StreamPull &pull, OutputColumnWriter &out, PartitionWriter &outputWriter, int code, const char *what)
+        {
+            SQLPOINTER *Ores_instance = Ores;
+            SQLLEN **Olen_instance = Olen;
+            size_t rows = 0;
+
+            for (RowsetStream *s; (s = pull.next()) != nullptr && !isCanceled();)
+            {
+                if (!s->error.empty())
+                {
+                    std::string error = s->node + ": " + s->error;
+                    pull.stop();
+                    clean(Ost, Ocon, Oenv);
+                    releaseQuery();
+                    vt_report_error(code, "DBLink. Error reading the %s %s", what, error.c_str());
+                }
+                Ores = s->Ores.data();
+                Olen = s->Olen.data();
+                nfr = s->nfr;
+                convertRowset(out, outputWriter);
+                Ores = Ores_instance;
+                Olen = Olen_instance;
+                rows += (size_t)nfr;
+                pull.release(s);
+            }
+            pull.stop();
+            return rows;
+        }
+
+        // Writes the result set to Parquet files of up to parquet_file_size bytes, converting each fetched rowset
+        // column by column (on the worker pool with workers), and returns one (file, rows) row per file
+        void processParquet(ServerInterface &srvInterface, PartitionWriter &outputWriter)
+        {
+            std::vector<int64_t> rows;
+            bool writing = false; // a file is open
+            std::string error;
+            SQLRETURN Oret = 0;
+            bool textInt = (dbt == ORACLE);
+
+            if (!prepared)
+            {
+                prepare(srvInterface, outputWriter.getTypeMetaData());
+            }
+            parquet_files.clear();
+            ParquetWriter pq(parquet_cols, parquet_codec); // kept across the files, with the compression ratio of the columns
+            acquireQuery(srvInterface);
+            if (!executed && !SQL_SUCCEEDED(Oret = executeStatement()) && Oret != SQL_NO_DATA)
+            {
+                ex_err(SQL_HANDLE_STMT, Ost, 403, "Error executing the statement", Ost, Ocon, Oenv);
+            }
+            executed = false;
+
+            while (SQL_SUCCEEDED(Oret = fetchRowset()) && Oret != SQL_NO_DATA && !isCanceled())
+            {
+                if (!writing)
+                { // written as a hidden file, renamed once complete
+                    std::string file = parquet_prefix + "-" + std::to_string(parquet_files.size()) + ".parquet";
+                    parquet_files.push_back(file);
+                    if (!pq.open(hiddenParquet(file), error))
+                    {
+                        parquetError(error);
+                    }
+                    writing = true;
+                }
+
+                DBLINK_PROBE1(convert_start, nfetch);
+                int64_t start = trace.now();
+                std::vector<ConvertStatus> status(Oncol, CONVERT_OK);
+                std::vector<size_t> errrow(Oncol, 0);
+                size_t nrows = (size_t)nfr;
+                auto appendColumn = [&](size_t j) {
+                    status[j] = pq.appendColumn(j, Odt[j], textInt, Ores[j], Olen[j], desz[j], nrows, errrow[j]);
+                };
+                if (pool)
+                {
+                    pool->run(Oncol, appendColumn);
+                }
+                else
+                {
+                    for (size_t j = 0; j < Oncol; j++)
+                    {
+                        appendColumn(j);
+                    }
+                }
+                for (size_t j = 0; j < Oncol; j++)
+                {
+                    if (status[j] != CONVERT_OK)
+                    {
+                        convertError(status[j], j);
+                    }
+                }
+                if (pq.endRows(nrows))
+                {
+                    if (pool)
+                    { // compress the last pages of the row group in parallel too
+                        pool->run(Oncol, [&](size_t j) { pq.flushPage(j); });
+                    }
+                    if (!pq.writeRowGroup(error))
+                    {
+                        parquetError(error);
+                    }
+                }
+                if (pq.failed(error))
+                {
+                    parquetError(error);
+                }
+                DBLINK_PROBE2(convert_done, nfetch, (unsigned long)nrows);
+                trace.span("convert", start, "\"rowset\":%lu,\"rows\":%lu", nfetch, (unsigned long)nrows);
+
+                if (pq.size() >= parquet_file_size)
+                {
+                    rows.push_back(pq.rows());
+                    closeParquet(pq);
+                    writing = false;
+                }
+            }
+            if (Oret == SQL_ERROR && direct.active())
+            {
+                srvInterface.log("DBLink direct fetch error: %s", direct.diag().c_str());
+            }
+            if (Oret == SQL_ERROR)
+            {
+                ex_err(SQL_HANDLE_STMT, Ost, 420, "Error fetching rows", Ost, Ocon, Oenv);
+            }
+            if (!SQL_SUCCEEDED(Oret = SQLFreeStmt(Ost, SQL_CLOSE)))
+            {
+                ex_err(SQL_HANDLE_STMT, Ost, 409, "Error closing the cursor", Ost, Ocon, Oenv);
+            }
+            releaseQuery();
+            if (writing)
+            {
+                rows.push_back(pq.rows());
+                closeParquet(pq);
+            }
+            if (isCanceled())
+            {
+                removeParquet();
+                return;
+            }
+
+            for (size_t k = 0; k < parquet_files.size(); k++)
+            {
+                outputWriter.getStringRef(0).copy(parquet_files[k]);
+                outputWriter.setInt(1, (vint)rows[k]);
+                outputWriter.next();
+            }
+            srvInterface.log("DBLink wrote %zu Parquet files", parquet_files.size());
+            parquet_files.clear();
+        }
+
+        // Temporary name of a Parquet file being written, skipped by the globs of COPY
+        std::string hiddenParquet(const std::string &file)
+        {
+            size_t slash = file.rfind('/');
+            return file.substr(0, slash + 1) + "." + file.substr(slash + 1) + ".tmp";
+        }
+
+        // Writes the footer of the last file and gives it its name
+        void closeParquet(ParquetWriter &pq)
+        {
+            std::string error;
+            const std::string &file = parquet_files.back();
+            if (!pq.close(error))
+            {
+                parquetError(error);
+            }
+            if (rename(hiddenParquet(file).c_str(), file.c_str()) != 0)
+            {
+                parquetError("renaming " + file + ": " + strerror(errno));
+            }
+        }
+
+        // Removes the files of a failed or canceled partition, complete or not
+        void removeParquet()
+        {
+            for (const std::string &file : parquet_files)
+            {
+                (void)unlink(file.c_str());
+                (void)unlink(hiddenParquet(file).c_str());
+            }
+            parquet_files.clear();
+        }
+
+        void parquetError(const std::string &error)
+        {
+            removeParquet();
+            clean(Ost, Ocon, Oenv);
+            releaseQuery();
+            vt_report_error(420, "DBLink. Error writing Parquet file. %s", error.c_str());
+        }
+
+        // A value is longer than the observed width of column j: its remote width is cached so that the next
+        // planning declares it (on this node, unless width_cache is shared), and the query fails instead of truncating the value
+        void widthOverflow(const SizedColumnTypes &outTypes, size_t j, SQLULEN remote)
+        {
+            std::map<size_t, SQLULEN> widths;
+            (void)loadWidths(width_file, widths, std::numeric_limits<time_t>::max());
+            widths[j] = remote;
+            saveWidths(width_file, widths);
+            clean(Ost, Ocon, Oenv);
+            vt_report_error(417, "DBLink. A value of column %s is longer than its observed width %d (width_sample). "
+                                 "The remote width %zu is recorded in <%s>, run the query again",
+                            outTypes.getColumnName(j).c_str(), outTypes.getColumnType(j).getStringLength(), (size_t)remote, width_file.c_str());
+        }
+
+        // Converts the nfr fetched rows into the output, between the convert_start/convert_done probes
+        void convertRowset(OutputColumnWriter &out, PartitionWriter &outputWriter)
+        {
+            size_t errcol = 0;
+
+            for (auto &n : narrowed)
+            {
+                for (size_t i = 0; i < nfr; i++)
+                {
+                    SQLLEN len = Olen[n.first][i];
+                    if (len == SQL_NO_TOTAL || (len != SQL_NULL_DATA && len >= (SQLLEN)desz[n.first]))
+                    {
+                        widthOverflow(outputWriter.getTypeMetaData(), n.first, n.second);
+                    }
+                }
+            }
+
+            DBLINK_PROBE1(convert_start, nfetch);
+            int64_t start = trace.now();
+            if (pool)
+            {
+                convertStaged(out, outputWriter);
+            }
+            else
+            {
+                for (size_t i = 0; i < nfr; i++, outputWriter.next())
+                {
+                    ConvertStatus rc = convertRow(out, Oncol, Odt.data(), dbt == ORACLE, Ores, Olen, desz.data(), i, errcol);
+                    if (rc != CONVERT_OK)
+                    {
+                        convertError(rc, errcol);
+                    }
+                }
+            }
+            DBLINK_PROBE2(convert_done, nfetch, (unsigned long)nfr);
+            trace.span("convert", start, "\"rowset\":%lu,\"rows\":%lu", nfetch, (unsigned long)nfr);
+        }
+
+        // Converts the fetched rowset on the worker pool, one column per task, then writes the staged values
+        void convertStaged(OutputColumnWriter &out, PartitionWriter &outputWriter)
+        {
+            std::vector<ConvertStatus> status(Oncol, CONVERT_OK);
+            std::vector<size_t> errrow(Oncol, 0);
+            bool textInt = (dbt == ORACLE);
+            size_t nrows = (size_t)nfr;
+
+            pool->run(Oncol, [&](size_t j) {
+                status[j] = stageColumn(staged + j * rowset, Odt[j], textInt, Ores[j], Olen[j], desz[j], nrows, errrow[j]);
+            });
+            for (size_t j = 0; j < Oncol; j++)
+            {
+                if (status[j] != CONVERT_OK)
+                {
+                    convertError(status[j], j);
+                }
+            }
+
+            for (size_t i = 0; i < nrows; i++, outputWriter.next())
+            {
+                for (size_t j = 0; j < Oncol; j++)
+                {
+                    if (!writeStaged(out, j, staged[j * rowset + i]))
+                    {
+                        convertError(CONVERT_NUMERIC, j);
+                    }
+                }
+            }
+        }
+
+        // Sleeps seconds in RETRY_STEP_MS steps. False if the statement was canceled meanwhile
+        bool retryWait(int seconds)
+        {
+            for (long ms = 0; ms < seconds * 1000L; ms += RETRY_STEP_MS)
+            {
+                if (isCanceled())
+                {
+                    return false;
+                }
+                usleep(RETRY_STEP_MS * 1000);
+            }
+            return !isCanceled();
+        }
+
+        // Recovers a resumable extraction from a transient failure of the statement: reconnects, retrying the
+        // connection within the max_retries attempts, so that the keyset query past the last emitted key is
+        // prepared again. Returns false if resume_key is not set, and reports the error if it is not transient
+        // or the retries are exhausted. attempt counts the failed connections too
+        bool resumeAfterError(ServerInterface &srvInterface, int &attempt, int loc, const char *vtext)
+        {
+            std::string diag;
+            if (!resume.enabled())
+            {
+                return false;
+            }
+            if (!isTransientError(Ost, diag) || attempt > max_retries)
+            {
+                ex_err(SQL_HANDLE_STMT, Ost, loc, vtext, Ost, Ocon, Oenv);
+            }
+
+            resume.advance();
+            if (!resume.file.empty())
+            {
+                resume.save();
+            }
+            clean(Ost, Ocon, Oenv);
+            releaseQuery();
+            conn_slot.release();
+            query = resume.keyset(base_query);
+
+            for (;; attempt++)
+            {
+                int wait = std::min(1 << std::min(attempt - 1, 16), MAX_RETRY_WAIT);
+                srvInterface.log("DBLink %s after %lld rows (%s). Reconnecting in %d s to resume after %s (attempt %d of %d)",
+                                 vtext, (long long)resume.rows, diag.c_str(), wait, resume.column.c_str(), attempt, max_retries);
+                if (!retryWait(wait))
+                {
+                    vt_report_error(415, "DBLink. Canceled while waiting to resume the extraction");
+                }
+                if (connect(srvInterface, &diag))
+                {
+                    break;
+                }
+                if (attempt >= max_retries)
+                {
+                    vt_report_error(110, "DBLink. Error connecting to target database after %d attempts. %s", attempt, diag.c_str());
+                }
+                vtext = "Error reconnecting";
+            }
+            acquireQuery(srvInterface);
+            return true;
+        }
+
+        void convertError(ConvertStatus rc, size_t j)
+        {
+            switch (rc)
+            {
+            case CONVERT_NUMERIC:
+                ex_err(0, 0, 404, "Error parsing Numeric", Ost, Ocon, Oenv);
+                break;
+            case CONVERT_INTERVAL_YM:
+                ex_err(0, 0, 405, "Unsupported INTERVAL data type. Expecting SQL_IS_YEAR_TO_MONTH", Ost, Ocon, Oenv);
+                break;
+            case CONVERT_INTERVAL_DS:
+                ex_err(0, 0, 406, "Unsupported INTERVAL data type. Expecting SQL_IS_DAY_TO_SECOND", Ost, Ocon, Oenv);
+                break;
+            default:
+                vt_report_error(407, "DBLINK. Unsupported data type for column %zu", j);
+            }
+        }
+
+        // Dry run of the SELECT: one "column" row per result set column with its binding and rowset buffer,
+        // a "memory" row with the scratch memory the factory requests, and the "plan" rows of the remote EXPLAIN
+        void explainQuery(ServerInterface &srvInterface, PartitionWriter &outputWriter)
+        {
+            SQLSMALLINT Onamel = 0;
             SQLSMALLINT Onull = 0;
             SQLCHAR Ocname[MAXCNAMELEN];
-            SQLUSMALLINT Oncol = 0;
-            SQLPOINTER *Ores;
-            SQLLEN **Olen;
-            StringParsers parser;
+            SQLCHAR Otname[MAXCNAMELEN];
+            SQLCHAR Obuff[MAX_ODBC_ERROR_LEN];
+            SQLSMALLINT Oncols = 0;
+            SQLRETURN Oret = 0;
+            size_t row_bytes = 0;
+
+            auto setText = [&](size_t j, const std::string &s)
+            {
+                if (s.empty())
+                {
+                    outputWriter.setNull(j);
+                }
+                else
+                {
+                    outputWriter.getStringRef(j).copy(s);
+                }
+            };
+            auto setCount = [&](size_t j, vint v)
+            {
+                if (v < 0)
+                {
+                    outputWriter.setNull(j);
+                }
+                else
+                {
+                    outputWriter.setInt(j, v);
+                }
+            };
 
+            // Describe the query as the factory does, without running it:
+            std::string describeQuery = getDescribeQuery(dbt, base_query);
+            bool described = describeQuery != base_query &&
+                             SQL_SUCCEEDED(Oret = SQLPrepare(Ost, (SQLCHAR *)describeQuery.c_str(), SQL_NTS)) &&
+                             SQL_SUCCEEDED(Oret = SQLNumResultCols(Ost, &Oncols));
+            if (!described)
+            {
+                (void)SQLFreeStmt(Ost, SQL_CLOSE);
+                if (!SQL_SUCCEEDED(Oret = SQLPrepare(Ost, (SQLCHAR *)base_query.c_str(), SQL_NTS)))
+                {
+                    ex_err(SQL_HANDLE_STMT, Ost, 112, "Error preparing the statement", Ost, Ocon, Oenv);
+                }
+                if (!SQL_SUCCEEDED(Oret = SQLNumResultCols(Ost, &Oncols)))
+                {
+                    ex_err(SQL_HANDLE_STMT, Ost, 115, "Error finding the number of resulting columns", Ost, Ocon, Oenv);
+                }
+            }
+
+            // Plan each column with the observed width the factory declares (width_sample):
+            std::map<size_t, SQLULEN> widths;
+            if (!width_file.empty())
+            {
+                (void)loadWidths(width_file, widths);
+            }
+
+            for (SQLSMALLINT j = 0; j < Oncols; j++)
+            {
+                SQLSMALLINT Ocdt = 0;
+                SQLULEN Ors = 0;
+                SQLSMALLINT Odd = 0;
+                SQLLEN Ool = 0;
+                SQLULEN width = 0;
+                ColumnPlan plan;
+                if (!SQL_SUCCEEDED(Oret = SQLDescribeCol(Ost, (SQLUSMALLINT)(j + 1),
+                                                         Ocname, (SQLSMALLINT)MAXCNAMELEN, &Onamel,
+                                                         &Ocdt, &Ors, &Odd, &Onull)))
+                {
+                    ex_err(SQL_HANDLE_STMT, Ost, 120, "Error getting column description", Ost, Ocon, Oenv);
+                }
+                Otname[0] = '\0';
+                (void)SQLColAttribute(Ost, (SQLUSMALLINT)(j + 1), SQL_DESC_TYPE_NAME,
+                                      (SQLPOINTER)Otname, (SQLSMALLINT)sizeof(Otname), (SQLSMALLINT *)NULL, NULL);
+                if (isStringType(Ocdt))
+                {
+                    (void)SQLColAttribute(Ost, (SQLUSMALLINT)(j + 1), SQL_DESC_OCTET_LENGTH,
+                                          (SQLPOINTER)NULL, (SQLSMALLINT)0, (SQLSMALLINT *)NULL, &Ool);
+                    auto it = widths.find((size_t)j);
+                    width = (it != widths.end()) ? it->second : 0;
+                }
+                bool supported = planColumn(dbt, Ocdt, Ors, Ool, Odd, width, plan);
+                size_t bytes = supported ? plan.desz + sizeof(SQLLEN) : 0;
+                row_bytes += bytes;
+
+                setText(0, "column");
+                setCount(1, (vint)j + 1);
+                setText(2, (char *)Ocname);
+                setText(3, (char *)Otname);
+                setCount(4, (vint)std::max((SQLULEN)Ool, Ors));
+                setText(5, plan.outputType);
+                setText(6, plan.ctype);
+                setCount(7, supported ? (vint)bytes : -1);
+                setCount(8, supported ? (vint)(bytes * rowset) : -1);
+                setText(9, plan.note);
+                outputWriter.next();
+            }
+            (void)SQLFreeStmt(Ost, SQL_CLOSE);
+
+            size_t staging = (workers > 1 && Oncols > 1) ? sizeof(StagedValue) * (size_t)Oncols * rowset : 0;
+            setText(0, "memory");
+            setCount(1, -1);
+            setText(2, "");
+            setText(3, "");
+            setCount(4, -1);
+            setText(5, "");
+            setText(6, "");
+            setCount(7, (vint)row_bytes);
+            setCount(8, (vint)(row_bytes * rowset + staging));
+            setText(9, "Scratch memory at rowset " + std::to_string(rowset) +
+                           (staging ? ", including " + std::to_string(staging) + " bytes of staging for " + std::to_string(workers) + " workers" : ""));
+            outputWriter.next();
+
+            // Remote plan, of the query as it would run (watermark filter or resume_key order included):
+            std::vector<std::string> plan;
+            std::vector<std::string> statements = getExplainQueries(dbt, query);
+            if (statements.empty())
+            {
+                plan.push_back("EXPLAIN is not supported for this database");
+            }
+            for (const std::string &stmt : statements)
+            {
+                (void)SQLFreeStmt(Ost, SQL_CLOSE);
+                (void)SQLFreeStmt(Ost, SQL_RESET_PARAMS);
+                bool bound = stmt.find(query) == std::string::npos || !watermark.hasMark() ||
+                             SQL_SUCCEEDED(watermark.bind(Ost));
+                if (!bound || !SQL_SUCCEEDED(Oret = SQLPrepare(Ost, (SQLCHAR *)stmt.c_str(), SQL_NTS)) ||
+                    (!SQL_SUCCEEDED(Oret = SQLExecute(Ost)) && Oret != SQL_NO_DATA))
+                {
+                    plan.push_back("EXPLAIN failed: " + diagText(SQL_HANDLE_STMT, Ost));
+                    break;
+                }
+                do
+                {
+                    SQLSMALLINT Opcols = 0;
+                    if (!SQL_SUCCEEDED(SQLNumResultCols(Ost, &Opcols)) || Opcols == 0)
+                    {
+                        continue;
+                    }
+                    while (SQL_SUCCEEDED(Oret = SQLFetch(Ost)) && Oret != SQL_NO_DATA)
+                    { // tabular plans (MySQL) are returned as " | " separated lines
+                        std::string line;
+                        for (SQLSMALLINT c = 1; c <= Opcols; c++)
+                        {
+                            SQLLEN Oind = 0;
+                            std::string value;
+                            while (SQL_SUCCEEDED(Oret = SQLGetData(Ost, (SQLUSMALLINT)c, SQL_C_CHAR, Obuff, (SQLLEN)sizeof(Obuff), &Oind)) &&
+                                   Oind != SQL_NULL_DATA)
+                            {
+                                value += (char *)Obuff;
+                                if (Oret == SQL_SUCCESS)
+                                {
+                                    break;
+                                }
+                            }
+                            line += (c > 1 ? " | " : "") + value;
+                        }
+                        plan.push_back(line);
+                    }
+                } while (SQL_SUCCEEDED(SQLMoreResults(Ost)));
+            }
+            (void)SQLFreeStmt(Ost, SQL_CLOSE);
+            (void)SQLFreeStmt(Ost, SQL_RESET_PARAMS);
+
+            for (size_t i = 0; i < plan.size(); i++)
+            {
+                setText(0, "plan");
+                setCount(1, (vint)i + 1);
+                for (size_t j = 2; j < 9; j++)
+                {
+                    outputWriter.setNull(j);
+                }
+                setText(9, plan[i]);
+                outputWriter.next();
+            }
+        }
+
+        void processPartition(ServerInterface &srvInterface,
+                              PartitionReader &inputReader,
+                              PartitionWriter &outputWriter)
+        {
             SQLRETURN Oret = 0;
-            SQLPOINTER Odp = nullptr;
-            SQLULEN Odl = 0;
-            SQLULEN nfr = 0;
+            OutputColumnWriter out(outputWriter);
 
-            // ODBC Connection:
-            if (!SQL_SUCCEEDED(Oret = SQLAllocHandle(SQL_HANDLE_ENV, (SQLHANDLE)SQL_NULL_HANDLE, &Oenv)))
+            if (backend)
             {
-                ex_err(0, 0, 107, "Error allocating Environment Handle", Ost, Ocon, Oenv);
+                backend->fetch(srvInterface, outputWriter);
+                return;
             }
-            if (!SQL_SUCCEEDED(Oret = SQLSetEnvAttr(Oenv, SQL_ATTR_ODBC_VERSION, (void *)SQL_OV_ODBC3, 0)))
+
+            if (!target.empty())
             {
-                ex_err(0, 0, 108, "Error setting SQL_OV_ODBC3", Ost, Ocon, Oenv);
+#ifdef DBLINK_LIBPQ
+                if (pgcopy)
+                {
+                    bool copied = false;
+                    try
+                    {
+                        copied = processPgBulk(srvInterface, inputReader, outputWriter);
+                    }
+                    catch (exception &e)
+                    {
+                        pgClose();
+                        releaseQuery();
+                        conn_slot.release();
+                        vt_report_error(400, "Exception while processing partition: [%s]", e.what());
+                    }
+                    if (copied)
+                    {
+                        return;
+                    }
+                }
+#endif
+                if (!Ost)
+                {
+                    connect(srvInterface);
+                }
+                try
+                {
+                    processBulk(srvInterface, inputReader, outputWriter);
+                }
+                catch (exception &e)
+                {
+                    clean(Ost, Ocon, Oenv);
+                    releaseQuery();
+                    conn_slot.release();
+                    vt_report_error(400, "Exception while processing partition: [%s]", e.what());
+                }
+                return;
             }
-            if (!SQL_SUCCEEDED(Oret = SQLAllocHandle(SQL_HANDLE_DBC, Oenv, &Ocon)))
+
+            if (explain)
             {
-                ex_err(0, 0, 109, "Error allocating Connection Handle", Ost, Ocon, Oenv);
+                if (!Ost)
+                {
+                    connect(srvInterface);
+                }
+                explainQuery(srvInterface, outputWriter);
+                return;
             }
-            if (!SQL_SUCCEEDED(Oret = SQLDriverConnect(Ocon, (SQLHWND)NULL, (SQLCHAR *)cid_value.c_str(), SQL_NTS, NULL, 0, NULL, SQL_DRIVER_NOPROMPT)))
+
+            if (!filter_key.empty())
             {
-                ex_err(SQL_HANDLE_DBC, Ocon, 110, "Error connecting to target database", Ost, Ocon, Oenv);
+                if (!Ost)
+                {
+                    connect(srvInterface);
+                }
+                try
+                {
+                    processFilter(srvInterface, inputReader, outputWriter);
+                }
+                catch (exception &e)
+                {
+                    clean(Ost, Ocon, Oenv);
+                    releaseQuery();
+                    conn_slot.release();
+                    vt_report_error(400, "Exception while processing partition: [%s]", e.what());
+                }
+                return;
             }
 
-            // ODBC Statement preparation:
-            if (!SQL_SUCCEEDED(Oret = SQLAllocHandle(SQL_HANDLE_STMT, Ocon, &Ost)))
+#ifdef DBLINK_LIBPQ
+            if (is_select && pgcopy && processPgCopy(srvInterface, outputWriter))
             {
-                ex_err(SQL_HANDLE_DBC, Ocon, 111, "Error allocating Statement Handle", Ost, Ocon, Oenv);
+                return;
             }
+#endif
 
-            // Check the DBMS we are connecting to:
-            if (!SQL_SUCCEEDED(Oret = SQLGetInfo(Ocon, SQL_DBMS_NAME,
-                                                 (SQLPOINTER)Obuff, (SQLSMALLINT)sizeof(Obuff), NULL)))
+            // The result set is written to Parquet files, only their names are returned:
+            if (!parquet_path.empty())
             {
-                ex_err(SQL_HANDLE_DBC, Ocon, 202, "Error getting remote DBMS Name", Ost, Ocon, Oenv);
+                if (!Ost)
+                {
+                    connect(srvInterface);
+                }
+                try
+                {
+                    processParquet(srvInterface, outputWriter);
+                }
+                catch (exception &e)
+                {
+                    removeParquet();
+                    clean(Ost, Ocon, Oenv);
+                    releaseQuery();
+                    conn_slot.release();
+                    vt_report_error(400, "Exception while processing partition: [%s]", e.what());
+                }
+                return;
             }
-            if (!strcmp((char *)Obuff, "Oracle"))
+
+            // A segmented remote Vertica table is read from all the remote nodes at once:
+            if (!segment_table.empty())
             {
-                dbt = ORACLE;
+                if (!Ost)
+                {
+                    connect(srvInterface);
+                }
+                try
+                {
+                    if (processSegments(srvInterface, outputWriter))
+                    {
+                        return;
+                    }
+                }
+                catch (exception &e)
+                {
+                    segments.stop();
+                    clean(Ost, Ocon, Oenv);
+                    releaseQuery();
+                    conn_slot.release();
+                    vt_report_error(400, "Exception while processing partition: [%s]", e.what());
+                }
             }
-            else
+
+            // Connection and statement are reused across partitions. The first one may take over the factory's:
+            if (!Ost && !(handoff && adoptHandoff(srvInterface)))
             {
-                dbt = GENERIC;
+                connect(srvInterface);
             }
-            memset(&Obuff[0], 0, sizeof(Obuff));
 
             try
             {
                 if (is_select)
                 {
-                    if (!SQL_SUCCEEDED(Oret = SQLPrepare(Ost, (SQLCHAR *)query.c_str(), SQL_NTS)))
-                    {
-                        ex_err(SQL_HANDLE_STMT, Ost, 112, "Error preparing the statement", Ost, Ocon, Oenv);
-                    }
-                    if (!SQL_SUCCEEDED(Oret = SQLNumResultCols(Ost, (SQLSMALLINT *)&Oncol)))
-                    {
-                        ex_err(SQL_HANDLE_STMT, Ost, 115, "Error finding the number of resulting columns", Ost, Ocon, Oenv);
-                    }
-
-                    std::unique_ptr<SQLSMALLINT[], decltype(&free)> Odt(static_cast<SQLSMALLINT *>(calloc((size_t)Oncol, sizeof(SQLSMALLINT))), std::free);
-                    if (Odt.get() == nullptr)
-                    {
-                        ex_err(0, 0, 116, "Error allocating data types array", Ost, Ocon, Oenv);
-                    }
-
-                    std::unique_ptr<SQLULEN[], decltype(&free)> Ors(static_cast<SQLULEN *>(calloc((size_t)Oncol, sizeof(SQLULEN))), std::free);
-                    if (Ors.get() == nullptr)
-                    {
-                        ex_err(0, 0, 117, "Error allocating result set columns size array", Ost, Ocon, Oenv);
-                    }
-
-                    std::unique_ptr<size_t[], decltype(&free)> desz(static_cast<size_t *>(calloc((size_t)Oncol, sizeof(size_t))), std::free);
-                    if (desz.get() == nullptr)
-                    {
-                        ex_err(0, 0, 118, "Error allocating data element size array", Ost, Ocon, Oenv);
+                    acquireQuery(srvInterface);
+                    if (resume.enabled())
+                    { // an earlier partition may have resumed: start again from the first key
+                        bool resumed = resume.hasMark();
+                        resume.clear();
+                        if (resumed)
+                        {
+                            query = resume.keyset(base_query);
+                            prepared = false;
+                        }
                     }
 
-                    std::unique_ptr<SQLSMALLINT[], decltype(&free)> Odd(static_cast<SQLSMALLINT *>(calloc((size_t)Oncol, sizeof(SQLSMALLINT))), std::free);
-                    if (Odd.get() == nullptr)
+                    bool completed = false;
+                    auto checkpointed = std::chrono::steady_clock::now();
+                    for (int attempt = 1;; attempt++)
                     {
-                        ex_err(0, 0, 119, "Error allocating result set decimal size array", Ost, Ocon, Oenv);
-                    }
-
-                    // Allocate memory for Result Set and length array pointers:
-                    Ores = (SQLPOINTER *)srvInterface.allocator->alloc(Oncol * sizeof(SQLPOINTER));
-                    Olen = (SQLLEN **)srvInterface.allocator->alloc(Oncol * sizeof(SQLLEN *));
-#ifdef DBLINK_DEBUG
-                    srvInterface.log("DEBUG DBLink num_col=%d allocated size Ores=%lu Olen=%lu", Oncol, malloc_usable_size(Ores), malloc_usable_size(Olen));
-#endif
+                        // Prepare once, and again on the new connection of a resumed extraction:
+                        if (!prepared && !prepare(srvInterface, outputWriter.getTypeMetaData()))
+                        {
+                            resumeAfterError(srvInterface, attempt, 112, "Error preparing the statement");
+                            continue;
+                        }
 
-                    // Allocate space for each column and bind it:
-                    for (unsigned int j = 0; j < Oncol; j++)
-                    {
-                        SQLLEN Ool = 0;
-                        if (!SQL_SUCCEEDED(Oret = SQLDescribeCol(Ost, (SQLUSMALLINT)(j + 1),
-                                                                 Ocname, (SQLSMALLINT)MAXCNAMELEN, &Onamel,
-                                                                 &Odt[j], &Ors[j], &Odd[j], &Onull)))
+                        // Time the first rowset of a replica group query, hedged past the hedge percentile:
+                        if (attempt == 1 && hedge_pct > 0)
                         {
-                            ex_err(SQL_HANDLE_STMT, Ost, 120, "Error getting column description", Ost, Ocon, Oenv);
+                            long delay = replicas.size() > 1 ? hedgeDelay(latency_file, hedge_pct) : -1;
+                            hedge.arm(Ost, delay, replicas.size() > 1 ? replicas[1] : "", query, bindTypes(), desz, rowset);
                         }
-#ifdef DBLINK_DEBUG
-                        srvInterface.log("DEBUG DBLink SQLDescribeCol src column=%u name=%s data_type=%d length=%zu", j, (char *)Ocname, Odt[j], Ors[j]);
-#endif
+                        hedged = false;
 
-                        Olen[j] = (SQLLEN *)srvInterface.allocator->alloc(sizeof(SQLLEN) * rowset);
-                        std::string cname((char *)Ocname);
-                        switch (Odt[j])
+                        // Execute Stateent (unless prepare() already did):
+                        if (!executed && !SQL_SUCCEEDED(Oret = executeStatement()) && Oret != SQL_NO_DATA)
                         {
-                        case SQL_SMALLINT:
-                        case SQL_INTEGER:
-                        case SQL_TINYINT:
-                        case SQL_BIGINT:
-                            desz[j] = (dbt == ORACLE) ? (size_t)(Ors[j] + 1) : sizeof(vint);
-                            Ores[j] = (SQLPOINTER)srvInterface.allocator->alloc(desz[j] * rowset);
-                            if (!SQL_SUCCEEDED(Oret = SQLBindCol(Ost, j + 1, (dbt == ORACLE) ? SQL_C_CHAR : SQL_C_SBIGINT, Ores[j], desz[j], Olen[j])))
-                            {
-                                ex_err(SQL_HANDLE_STMT, Ost, 401, "Error binding column", Ost, Ocon, Oenv);
+                            if (hedge.pending() && (hedged = hedge.settle()))
+                            { // the primary stalled in SQLExecute (drivers buffering the result set) and was canceled
+                                Oret = SQL_NO_DATA;
                             }
-                            break;
-                        case SQL_REAL:
-                        case SQL_DOUBLE:
-                        case SQL_FLOAT:
-                            desz[j] = sizeof(vfloat);
-                            Ores[j] = (SQLPOINTER)srvInterface.allocator->alloc(desz[j] * rowset);
-                            if (!SQL_SUCCEEDED(Oret = SQLBindCol(Ost, j + 1, SQL_C_DOUBLE, Ores[j], desz[j], Olen[j])))
-                                ex_err(SQL_HANDLE_STMT, Ost, 401, "Error binding column", Ost, Ocon, Oenv);
-                            break;
-                        case SQL_NUMERIC:
-                        case SQL_DECIMAL:
-                            desz[j] = MAX_NUMERIC_CHARLEN;
-                            Ores[j] = (SQLPOINTER)srvInterface.allocator->alloc(desz[j] * rowset);
-                            if (!SQL_SUCCEEDED(Oret = SQLBindCol(Ost, j + 1, SQL_C_CHAR, Ores[j], desz[j], Olen[j])))
-                                ex_err(SQL_HANDLE_STMT, Ost, 401, "Error binding column", Ost, Ocon, Oenv);
-                            break;
-                        case SQL_CHAR:
-                        case SQL_VARCHAR:
-                        case SQL_WCHAR:
-                        case SQL_WVARCHAR:
-                            if (!SQL_SUCCEEDED(Oret = SQLColAttribute(Ost, (SQLUSMALLINT)(j + 1), SQL_DESC_OCTET_LENGTH,
-                                                                      (SQLPOINTER)NULL, (SQLSMALLINT)0, (SQLSMALLINT *)NULL, &Ool)))
+                            else
                             {
-                                ex_err(SQL_HANDLE_STMT, Ost, 120, "Error getting column description", Ost, Ocon, Oenv);
+                                hedge.finish();
+                                if (resumeAfterError(srvInterface, attempt, 403, "Error executing the statement"))
+                                {
+                                    continue;
+                                }
+                                ex_err(SQL_HANDLE_STMT, Ost, 403, "Error executing the statement", Ost, Ocon, Oenv);
                             }
+                        }
+                        executed = false;
 #ifdef DBLINK_DEBUG
-                            srvInterface.log("DEBUG DBLink SQLColAttribute SQL_DESC_OCTET_LENGTH src column=%u name=%s data_type=%d length=%ld", j, (char *)Ocname, Odt[j], Ool);
+                        srvInterface.log("DEBUG DBLink Executed the statement");
 #endif
-                            if (Ool > 0 && (SQLULEN)Ool > Ors[j])
-                            {
-                                Ors[j] = Ool;
-                            }
-                            if (Ors[j] > MAX_CHAR_LEN)
-                            {
-                                srvInterface.log("DBLink SQL_[W]CHAR/SQL_[W]VARCHAR column %s of length %zu limited to %d bytes", (char *)Ocname, Ors[j], MAX_CHAR_LEN);
-                                Ors[j] = MAX_CHAR_LEN;
-                            }
-                            desz[j] = (size_t)(Ors[j] + 1);
-                            if (!Ors[j])
-                            {
-                                Ors[j] = 1;
-                            }
-                            Ores[j] = (SQLPOINTER)srvInterface.allocator->alloc(desz[j] * rowset);
-                            if (!SQL_SUCCEEDED(Oret = SQLBindCol(Ost, j + 1, SQL_C_CHAR, Ores[j], desz[j], Olen[j])))
-                                ex_err(SQL_HANDLE_STMT, Ost, 401, "Error binding column", Ost, Ocon, Oenv);
-                            break;
-                        case SQL_LONGVARCHAR:
-                        case SQL_WLONGVARCHAR:
-                            if (!SQL_SUCCEEDED(Oret = SQLColAttribute(Ost, (SQLUSMALLINT)(j + 1), SQL_DESC_OCTET_LENGTH,
-                                                                      (SQLPOINTER)NULL, (SQLSMALLINT)0, (SQLSMALLINT *)NULL, &Ool)))
+
+                        // Fetch loop, unless the hedged replica already answered:
+                        while (!hedged && SQL_SUCCEEDED(Oret = fetchRowset()) && !isCanceled())
+                        {
+                            if (Oret == SQL_NO_DATA_FOUND)
                             {
-                                ex_err(SQL_HANDLE_STMT, Ost, 120, "Error getting column description", Ost, Ocon, Oenv);
-                            }
 #ifdef DBLINK_DEBUG
-                            srvInterface.log("DEBUG DBLink SQLColAttribute SQL_DESC_OCTET_LENGTH src column=%u name=%s data_type=%d length=%ld", j, (char *)Ocname, Odt[j], Ool);
+                                srvInterface.log("DEBUG DBLink End of record set");
 #endif
-                            if (Ool > 0 && (SQLULEN)Ool > Ors[j])
-                            {
-                                Ors[j] = Ool;
-                            }
-                            if (Ors[j] > MAX_LONGCHAR_LEN)
-                            {
-                                Ors[j] = MAX_LONGCHAR_LEN;
-                            }
-                            desz[j] = (size_t)(Ors[j] + 1);
-                            if (!Ors[j])
-                            {
-                                Ors[j] = 1;
+                                break;
                             }
-                            Ores[j] = (SQLPOINTER)srvInterface.allocator->alloc(desz[j] * rowset);
-                            if (!SQL_SUCCEEDED(Oret = SQLBindCol(Ost, j + 1, SQL_C_CHAR, Ores[j], desz[j], Olen[j])))
-                                ex_err(SQL_HANDLE_STMT, Ost, 401, "Error binding column", Ost, Ocon, Oenv);
-                            break;
-                        case SQL_TYPE_TIME:
-                            desz[j] = sizeof(SQL_TIME_STRUCT);
-                            Ores[j] = (SQLPOINTER)srvInterface.allocator->alloc(desz[j] * rowset);
-                            if (!SQL_SUCCEEDED(Oret = SQLBindCol(Ost, j + 1, SQL_C_TIME, Ores[j], desz[j], Olen[j])))
-                                ex_err(SQL_HANDLE_STMT, Ost, 401, "Error binding column", Ost, Ocon, Oenv);
-                            break;
-                        case SQL_TYPE_DATE:
-                            desz[j] = sizeof(SQL_DATE_STRUCT);
-                            Ores[j] = (SQLPOINTER)srvInterface.allocator->alloc(desz[j] * rowset);
-                            if (!SQL_SUCCEEDED(Oret = SQLBindCol(Ost, j + 1, SQL_C_DATE, Ores[j], desz[j], Olen[j])))
-                                ex_err(SQL_HANDLE_STMT, Ost, 401, "Error binding column", Ost, Ocon, Oenv);
-                            break;
-                        case SQL_TYPE_TIMESTAMP:
-                            desz[j] = sizeof(SQL_TIMESTAMP_STRUCT);
-                            Ores[j] = (SQLPOINTER)srvInterface.allocator->alloc(desz[j] * rowset);
-                            if (!SQL_SUCCEEDED(Oret = SQLBindCol(Ost, j + 1, SQL_C_TIMESTAMP, Ores[j], desz[j], Olen[j])))
-                                ex_err(SQL_HANDLE_STMT, Ost, 401, "Error binding column", Ost, Ocon, Oenv);
-                            break;
-                        case SQL_BIT:
-                            desz[j] = 1;
-                            Ores[j] = (SQLPOINTER)srvInterface.allocator->alloc(desz[j] * rowset);
-                            if (!SQL_SUCCEEDED(Oret = SQLBindCol(Ost, j + 1, SQL_C_BIT, Ores[j], desz[j], Olen[j])))
-                                ex_err(SQL_HANDLE_STMT, Ost, 401, "Error binding column", Ost, Ocon, Oenv);
-                            break;
-                        case SQL_BINARY:
-                        case SQL_VARBINARY:
-                            if (Ors[j] > MAX_BINARY_LEN)
+
+#ifdef DBLINK_DEBUG
+                            srvInterface.log("DEBUG DBLink rows fetched=%lu", nfr);
+#endif
+
+                            convertRowset(out, outputWriter);
+                            if (wm_idx >= 0)
                             {
-                                Ors[j] = MAX_BINARY_LEN;
+                                watermark.track(wm_kind, dbt == ORACLE, Ores[wm_idx], Olen[wm_idx], desz[wm_idx], nfr);
                             }
-                            desz[j] = (size_t)(Ors[j] + 1);
-                            Ores[j] = (SQLPOINTER)srvInterface.allocator->alloc(desz[j] * rowset);
-                            if (!SQL_SUCCEEDED(Oret = SQLBindCol(Ost, j + 1, SQL_C_BINARY, Ores[j], desz[j], Olen[j])))
-                                ex_err(SQL_HANDLE_STMT, Ost, 401, "Error binding column", Ost, Ocon, Oenv);
-                            break;
-                        case SQL_LONGVARBINARY:
-                            if (Ors[j] > MAX_LONGBINARY_LEN)
-                            {
-                                Ors[j] = MAX_LONGBINARY_LEN;
+                            if (rs_idx >= 0)
+                            { // the rows are ordered by the key: the last one is the checkpoint
+                                resume.track(rs_kind, dbt == ORACLE, Ores[rs_idx], Olen[rs_idx], desz[rs_idx], nfr);
+                                resume.rows += (vint)nfr;
+                                auto now = std::chrono::steady_clock::now();
+                                if (!resume.file.empty() && now - checkpointed >= std::chrono::seconds(CHECKPOINT_SECONDS))
+                                {
+                                    resume.save();
+                                    checkpointed = now;
+                                }
                             }
-                            desz[j] = (size_t)(Ors[j] + 1);
-                            Ores[j] = (SQLPOINTER)srvInterface.allocator->alloc(desz[j] * rowset);
-                            if (!SQL_SUCCEEDED(Oret = SQLBindCol(Ost, j + 1, SQL_C_BINARY, Ores[j], desz[j], Olen[j])))
-                                ex_err(SQL_HANDLE_STMT, Ost, 401, "Error binding column", Ost, Ocon, Oenv);
-                            break;
-                        case SQL_INTERVAL_YEAR_TO_MONTH:
-                            desz[j] = sizeof(SQL_INTERVAL_STRUCT);
-                            Ores[j] = (SQLPOINTER)srvInterface.allocator->alloc(desz[j] * rowset);
-                            if (!SQL_SUCCEEDED(Oret = SQLBindCol(Ost, j + 1, SQL_C_INTERVAL_YEAR_TO_MONTH, Ores[j], desz[j], Olen[j])))
-                                ex_err(SQL_HANDLE_STMT, Ost, 401, "Error binding column", Ost, Ocon, Oenv);
-                            break;
-                        case SQL_INTERVAL_DAY_TO_SECOND:
-                            desz[j] = sizeof(SQL_INTERVAL_STRUCT);
-                            Ores[j] = (SQLPOINTER)srvInterface.allocator->alloc(desz[j] * rowset);
-                            if (!SQL_SUCCEEDED(Oret = SQLBindCol(Ost, j + 1, SQL_C_INTERVAL_DAY_TO_SECOND, Ores[j], desz[j], Olen[j])))
-                                ex_err(SQL_HANDLE_STMT, Ost, 401, "Error binding column", Ost, Ocon, Oenv);
+                        }
+
+                        if (hedged)
+                        {
+                            srvInterface.log("DBLink no rowset from the replica after %ld ms, the hedged replica answered first", hedge.delay);
+                            (void)SQLFreeStmt(Ost, SQL_CLOSE);
+                            (void)drainStreams(hedge.pull, out, outputWriter, 419, "hedged query on");
+                        }
+
+                        if (Oret == SQL_ERROR && direct.active())
+                        { // the driver manager did not see the failed call, its diagnostics are with the driver
+                            srvInterface.log("DBLink direct fetch error: %s", direct.diag().c_str());
+                        }
+                        completed = (Oret == SQL_NO_DATA);
+                        if (Oret != SQL_ERROR || isCanceled() ||
+                            !resumeAfterError(srvInterface, attempt, 415, "Error fetching rows"))
+                        {
                             break;
-                        default:
-                            vt_report_error(121, "DBLink. Unsupported data type for column %u", j);
                         }
                     }
-#ifdef DBLINK_DEBUG
-                    srvInterface.log("DEBUG DBLink Allocation and Binding were completed");
-#endif
 
-                    // Set Statement attributes:
-                    if (!SQL_SUCCEEDED(Oret = SQLSetStmtAttr(Ost, SQL_ATTR_ROW_BIND_TYPE, (SQLPOINTER)SQL_BIND_BY_COLUMN, 0)))
-                    {
-                        ex_err(SQL_HANDLE_STMT, Ost, 402, "Error setting statement attribute SQL_ATTR_ROW_BIND_TYPE", Ost, Ocon, Oenv);
-                    }
-                    if (!SQL_SUCCEEDED(Oret = SQLSetStmtAttr(Ost, SQL_ATTR_ROW_ARRAY_SIZE, (SQLPOINTER)rowset, 0)))
+                    // Close the cursor so the prepared statement can be executed again by the next partition:
+                    if (!SQL_SUCCEEDED(Oret = SQLFreeStmt(Ost, SQL_CLOSE)))
                     {
-                        ex_err(SQL_HANDLE_STMT, Ost, 402, "Error setting statement attribute SQL_ATTR_ROW_ARRAY_SIZE", Ost, Ocon, Oenv);
+                        ex_err(SQL_HANDLE_STMT, Ost, 409, "Error closing the cursor", Ost, Ocon, Oenv);
                     }
-                    if (!SQL_SUCCEEDED(Oret = SQLSetStmtAttr(Ost, SQL_ATTR_ROWS_FETCHED_PTR, &nfr, 0)))
+                    releaseQuery();
+
+                    // Record the first rowset latency of the replica group:
+                    if (hedge_pct > 0)
                     {
-                        ex_err(SQL_HANDLE_STMT, Ost, 402, "Error setting statement attribute SQL_ATTR_ROWS_FETCHED_PTR", Ost, Ocon, Oenv);
+                        hedge.finish();
+                        if (!hedge.error.empty())
+                        {
+                            srvInterface.log("DBLink hedged query failed: %s", hedge.error.c_str());
+                        }
+                        if (hedge.firstRowset() >= 0)
+                        {
+                            recordLatency(latency_file, hedge.firstRowset());
+                        }
                     }
-#ifdef DBLINK_DEBUG
-                    srvInterface.log("DEBUG DBLink Setting attributes were completed");
-#endif
 
-                    // Execute Stateent:
-                    if (!SQL_SUCCEEDED(Oret = SQLExecute(Ost)) && Oret != SQL_NO_DATA)
+                    if (completed && rs_idx >= 0 && !resume.file.empty())
                     {
-                        ex_err(SQL_HANDLE_STMT, Ost, 403, "Error executing the statement", Ost, Ocon, Oenv);
+                        (void)unlink(resume.file.c_str());
                     }
-#ifdef DBLINK_DEBUG
-                    srvInterface.log("DEBUG DBLink Executed the statement");
-#endif
 
-                    // Fetch loop:
-                    while (SQL_SUCCEEDED(Oret = SQLFetchScroll(Ost, SQL_FETCH_NEXT, 0)) && !isCanceled())
+                    // Report the new high-water mark once the whole result set was fetched. The statement has not
+                    // committed yet, so the caller advances the state file once it does:
+                    if (completed && wm_idx >= 0)
                     {
-                        if (Oret == SQL_NO_DATA_FOUND)
-                        {
-#ifdef DBLINK_DEBUG
-                            srvInterface.log("DEBUG DBLink End of record set");
-#endif
-                            break;
-                        }
-
-#ifdef DBLINK_DEBUG
-                        srvInterface.log("DEBUG DBLink rows fetched=%lu", nfr);
-#endif
-
-                        for (unsigned int i = 0; i < nfr; i++, outputWriter.next())
+                        std::string mark = watermark.mark();
+                        if (!mark.empty())
                         {
-                            for (unsigned int j = 0; j < Oncol; j++)
-                            {
-                                Odp = (SQLPOINTER)((uint8_t *)Ores[j] + desz[j] * i);
-                                Odl = Olen[j][i];
-
-                                if ((int)Odl == (int)SQL_NULL_DATA)
-                                {
-                                    outputWriter.setNull(j);
-                                    continue;
-                                }
-
-                                switch (Odt[j])
-                                {
-                                case SQL_SMALLINT:
-                                case SQL_INTEGER:
-                                case SQL_TINYINT:
-                                case SQL_BIGINT:
-                                {
-                                    if (dbt == ORACLE)
-                                    {
-                                        outputWriter.setInt(j, ((int)Odl == SQL_NTS) ? vint_null : (vint)atoll((char *)Odp));
-                                    }
-                                    else
-                                    {
-                                        outputWriter.setInt(j, *(SQLBIGINT *)Odp);
-                                    }
-                                    break;
-                                }
-                                case SQL_REAL:
-                                case SQL_DOUBLE:
-                                case SQL_FLOAT:
-                                {
-                                    outputWriter.setFloat(j, *(SQLDOUBLE *)Odp);
-                                    break;
-                                }
-                                case SQL_NUMERIC:
-                                case SQL_DECIMAL:
-                                {
-                                    std::string rejectReason = "Unrecognized remote database format";
-                                    if (*(char *)Odp == '\0')
-                                    { // some DBs might use empty strings for NUMERIC nulls
-                                        outputWriter.setNull(j);
-                                    }
-                                    else
-                                    {
-                                        if (!parser.parseNumeric((char *)Odp, (size_t)Odl, j,
-                                                                 outputWriter.getNumericRef(j), outputWriter.getTypeMetaData().getColumnType(j), rejectReason))
-                                        {
-                                            ex_err(0, 0, 404, "Error parsing Numeric", Ost, Ocon, Oenv);
-                                        }
-                                    }
-                                    break;
-                                }
-                                case SQL_CHAR:
-                                case SQL_WCHAR:
-                                case SQL_VARCHAR:
-                                case SQL_WVARCHAR:
-                                case SQL_LONGVARCHAR:
-                                case SQL_WLONGVARCHAR:
-                                case SQL_BINARY:
-                                case SQL_VARBINARY:
-                                case SQL_LONGVARBINARY:
-                                {
-                                    if ((int)Odl == SQL_NTS)
-                                    {
-                                        Odl = (SQLULEN)strnlen((char *)Odp, desz[j]);
-                                    }
-                                    outputWriter.getStringRef(j).copy((char *)Odp, Odl);
-                                    break;
-                                }
-                                case SQL_TYPE_TIME:
-                                {
-                                    SQL_TIME_STRUCT &st = *(SQL_TIME_STRUCT *)Odp;
-                                    outputWriter.setTime(j, getTimeFromUnixTime(st.second + st.minute * 60 + st.hour * 3600));
-                                    break;
-                                }
-                                case SQL_TYPE_DATE:
-                                {
-                                    SQL_DATE_STRUCT &sd = *(SQL_DATE_STRUCT *)Odp;
-                                    struct tm d = {0, 0, 0, sd.day, sd.month - 1, sd.year - 1900, 0, 0, -1};
-                                    time_t utime = mktime(&d);
-                                    outputWriter.setDate(j, getDateFromUnixTime(utime + d.tm_gmtoff));
-                                    break;
-                                }
-                                case SQL_TYPE_TIMESTAMP:
-                                {
-                                    SQL_TIMESTAMP_STRUCT &ss = *(SQL_TIMESTAMP_STRUCT *)Odp;
-                                    struct tm ts = {ss.second, ss.minute, ss.hour, ss.day, ss.month - 1, ss.year - 1900, 0, 0, -1};
-                                    time_t utime = mktime(&ts);
-                                    outputWriter.setTimestamp(j, getTimestampFromUnixTime(utime + ts.tm_gmtoff) + ss.fraction / 1000);
-                                    break;
-                                }
-                                case SQL_BIT:
-                                    outputWriter.setBool(j, *(SQLCHAR *)Odp == SQL_TRUE ? VTrue : VFalse);
-                                    break;
-                                case SQL_INTERVAL_YEAR_TO_MONTH: // Vertica stores these Intervals as durations in months
-                                {
-                                    SQL_INTERVAL_STRUCT &intv = *(SQL_INTERVAL_STRUCT *)Odp;
-                                    if (intv.interval_type != SQL_IS_YEAR_TO_MONTH)
-                                    {
-                                        ex_err(0, 0, 405, "Unsupported INTERVAL data type. Expecting SQL_IS_YEAR_TO_MONTH", Ost, Ocon, Oenv);
-                                    }
-                                    Interval ret = ((intv.intval.year_month.year * MONTHS_PER_YEAR) + (intv.intval.year_month.month)) * (intv.interval_sign == SQL_TRUE ? -1 : 1);
-                                    outputWriter.setInterval(j, ret);
-                                    break;
-                                }
-                                case SQL_INTERVAL_DAY_TO_SECOND: // Vertica stores these Intervals as durations in microseconds
-                                {
-                                    SQL_INTERVAL_STRUCT &intv = *(SQL_INTERVAL_STRUCT *)Odp;
-                                    if (intv.interval_type != SQL_IS_DAY_TO_SECOND)
-                                    {
-                                        ex_err(0, 0, 406, "Unsupported INTERVAL data type. Expecting SQL_IS_DAY_TO_SECOND", Ost, Ocon, Oenv);
-                                    }
-                                    Interval ret = ((intv.intval.day_second.day * usPerDay) + (intv.intval.day_second.hour * usPerHour) + (intv.intval.day_second.minute * usPerMinute) + (intv.intval.day_second.second * usPerSecond) + (intv.intval.day_second.fraction / 1000)) * (intv.interval_sign == SQL_TRUE ? -1 : 1);
-                                    outputWriter.setInterval(j, ret);
-                                    break;
-                                }
-                                default:
-                                    vt_report_error(407, "DBLINK. Unsupported data type for column %u", j);
-                                    break;
-                                }
-                            }
+                            srvInterface.log("DBLink watermark %s reached <%s>. Write it to <%s> once the statement commits",
+                                             watermark.column.c_str(), mark.c_str(), watermark.file.c_str());
                         }
                     }
                 }
@@ -770,7 +6030,10 @@ namespace DBLINK
 #ifdef DBLINK_DEBUG
                 srvInterface.log("DEBUG DBLink clean called in catch in DBLink::processPartition");
 #endif
+                hedge.finish();
                 clean(Ost, Ocon, Oenv);
+                releaseQuery();
+                conn_slot.release();
                 vt_report_error(400, "Exception while processing partition: [%s]", e.what());
             }
         }
@@ -784,6 +6047,7 @@ namespace DBLINK
                           ColumnTypes &argTypes,
                           ColumnTypes &returnType)
         {
+            argTypes.addAny();
             returnType.addAny();
         }
 
@@ -794,39 +6058,231 @@ namespace DBLINK
             SQLCHAR Obuff[64];
             DBs dbt;
 
-            SQLHENV Oenv = nullptr;
-            SQLHDBC Ocon = nullptr;
-            SQLHSTMT Ost = nullptr;
-            SQLRETURN Oret = 0;
-            SQLSMALLINT Onamel = 0;
-            SQLSMALLINT Onull = 0;
-            SQLCHAR Ocname[MAXCNAMELEN];
-            SQLUSMALLINT Oncol = 0;
-            bool is_select = false;
-            std::string cid_value = "";
-            std::string query = "";
-            size_t rowset = 0;
+            SQLHENV Oenv = nullptr;
+            SQLHDBC Ocon = nullptr;
+            SQLHSTMT Ost = nullptr;
+            SQLRETURN Oret = 0;
+            SQLSMALLINT Onamel = 0;
+            SQLSMALLINT Onull = 0;
+            SQLCHAR Ocname[MAXCNAMELEN];
+            SQLUSMALLINT Oncol = 0;
+            bool is_select = false;
+            bool described = false;
+            std::string cid_value = "";
+            std::string query = "";
+            size_t rowset = 0;
+            GovernorParams gov;
+            GovernorSlot slot; // released when leaving getReturnType, unless handed off
+            std::vector<std::string> replicas;
+
+            // A replica group is described on its least loaded member:
+            getCidValue(srvInterface, cid_value, &replicas);
+            if (replicas.size() > 1)
+            {
+                routeReplicas(replicas);
+                cid_value = replicas[0];
+            }
+
+            // Read/Set rowset Param:
+            ParamReader params = srvInterface.getParamReader();
+            if (params.containsParameter("rowset"))
+            {
+                vint rowset_param = params.getIntRef("rowset");
+                if (rowset_param < 1 || rowset_param > MAX_ROWSET)
+                {
+                    ex_err(0, 0, 203, "DBLink. Error rowset out of range", Ost, Ocon, Oenv);
+                }
+                else
+                {
+                    rowset = (size_t)rowset_param;
+                }
+            }
+            else
+            {
+                rowset = DEF_ROWSET;
+            }
+
+            // Check workers Param:
+            size_t workers = 0;
+            if (params.containsParameter("workers"))
+            {
+                vint workers_param = params.getIntRef("workers");
+                if (workers_param < 0 || workers_param == 1 || workers_param > MAX_WORKERS)
+                { // one worker would only add a staging pass to the serial conversion
+                    ex_err(0, 0, 211, "DBLink. Error workers must be 0 or between 2 and 16", Ost, Ocon, Oenv);
+                }
+                workers = (size_t)workers_param;
+                if (params.containsParameter("pgcopy") && params.getBoolRef("pgcopy") == VTrue)
+                {
+                    workers = 0; // see DBLink::setup
+                }
+            }
+
+            // Check handoff Param:
+            if (params.containsParameter("handoff"))
+            {
+                std::string handoff = params.getStringRef("handoff").str();
+                if (strcasecmp(handoff.c_str(), "none") && strcasecmp(handoff.c_str(), "prepare"))
+                {
+                    ex_err(0, 0, 214, "DBLink. Error handoff must be none or prepare", Ost, Ocon, Oenv);
+                }
+            }
+
+            // Bulk export returns the number of rows pushed to the target table:
+            if (params.containsParameter("target"))
+            {
+                checkBulk(srvInterface, params, cid_value, inputTypes, rowset);
+                outputTypes.addInt("dblink");
+                return;
+            }
+            getQuery(srvInterface, query, is_select);
+            if (params.containsParameter("filter_key"))
+            {
+                checkFilter(params, cid_value, inputTypes, is_select);
+            }
+            else if (inputTypes.getColumnCount() > 0)
+            {
+                ex_err(0, 0, 210, "DBLink. Error input columns require the target or filter_key parameter", Ost, Ocon, Oenv);
+            }
+
+            // Check segment_table Param:
+            if (params.containsParameter("segment_table") &&
+                (!is_select || !strncasecmp(cid_value.c_str(), "ADBC:", 5) || params.containsParameter("watermark") ||
+                 params.containsParameter("resume_key") || params.containsParameter("filter_key") ||
+                 (params.containsParameter("pgcopy") && params.getBoolRef("pgcopy") == VTrue)))
+            {
+                ex_err(0, 0, 217, "DBLink. Error segment_table requires a SELECT statement on an ODBC connection, without watermark, resume_key, filter_key or pgcopy", Ost, Ocon, Oenv);
+            }
+
+            // Check hedge Param:
+            if (params.containsParameter("hedge"))
+            {
+                vint hedge = params.getIntRef("hedge");
+                if (hedge < 0 || hedge > 99)
+                {
+                    ex_err(0, 0, 218, "DBLink. Error hedge out of range", Ost, Ocon, Oenv);
+                }
+                if (hedge > 0 &&
+                    (!is_select || replicas.size() < 2 || !strncasecmp(cid_value.c_str(), "ADBC:", 5) ||
+                     params.containsParameter("watermark") || params.containsParameter("resume_key") ||
+                     params.containsParameter("filter_key") || params.containsParameter("segment_table") ||
+                     (params.containsParameter("pgcopy") && params.getBoolRef("pgcopy") == VTrue)))
+                {
+                    ex_err(0, 0, 218, "DBLink. Error hedge requires a SELECT statement on a replica group CID, without watermark, resume_key, filter_key, segment_table or pgcopy", Ost, Ocon, Oenv);
+                }
+            }
+
+            // Check parquet Params:
+            if (params.containsParameter("parquet_path"))
+            {
+                if (!is_select || !strncasecmp(cid_value.c_str(), "ADBC:", 5) || params.containsParameter("watermark") ||
+                    params.containsParameter("resume_key") || params.containsParameter("filter_key") || params.containsParameter("segment_table") ||
+                    (params.containsParameter("hedge") && params.getIntRef("hedge") > 0) || params.containsParameter("schema") ||
+                    params.containsParameter("width_sample") || (params.containsParameter("explain") && params.getBoolRef("explain") == VTrue) ||
+                    (params.containsParameter("pgcopy") && params.getBoolRef("pgcopy") == VTrue))
+                {
+                    ex_err(0, 0, 219, "DBLink. Error parquet_path requires a SELECT statement on an ODBC connection, without watermark, resume_key, filter_key, segment_table, hedge, schema, width_sample, explain or pgcopy", Ost, Ocon, Oenv);
+                }
+                std::string path = params.getStringRef("parquet_path").str();
+                if (path.empty() || path.size() > MAX_PARQUET_PATH - MAXCNAMELEN * 2)
+                {
+                    ex_err(0, 0, 219, "DBLink. Error parquet_path is empty or too long", Ost, Ocon, Oenv);
+                }
+                if (params.containsParameter("parquet_file_size") &&
+                    (params.getIntRef("parquet_file_size") < 1 || params.getIntRef("parquet_file_size") > MAX_PARQUET_FILE_MB))
+                {
+                    ex_err(0, 0, 219, "DBLink. Error parquet_file_size out of range", Ost, Ocon, Oenv);
+                }
+                if (params.containsParameter("parquet_compression") &&
+                    strcasecmp(params.getStringRef("parquet_compression").str().c_str(), "gzip") &&
+                    strcasecmp(params.getStringRef("parquet_compression").str().c_str(), "none"))
+                {
+                    ex_err(0, 0, 219, "DBLink. Error parquet_compression must be gzip or none", Ost, Ocon, Oenv);
+                }
+            }
+            else if (params.containsParameter("parquet_file_size") || params.containsParameter("parquet_compression"))
+            {
+                ex_err(0, 0, 219, "DBLink. Error parquet_file_size and parquet_compression require parquet_path", Ost, Ocon, Oenv);
+            }
+
+            // Check watermark Params:
+            if (params.containsParameter("watermark"))
+            {
+                if (!is_select || !params.containsParameter("watermark_file"))
+                {
+                    ex_err(0, 0, 206, "DBLink. Error watermark requires a SELECT statement and watermark_file", Ost, Ocon, Oenv);
+                }
+                if (params.containsParameter("pgcopy") && params.getBoolRef("pgcopy") == VTrue)
+                {
+                    ex_err(0, 0, 206, "DBLink. Error watermark cannot be used with pgcopy", Ost, Ocon, Oenv);
+                }
+            }
 
-            getCidValue(srvInterface, cid_value);
-            getQuery(srvInterface, query, is_select);
+            // Check width_sample Param. pgcopy would truncate the values longer than the observed widths:
+            if (params.containsParameter("width_sample") && params.containsParameter("pgcopy") && params.getBoolRef("pgcopy") == VTrue)
+            {
+                ex_err(0, 0, 216, "DBLink. Error width_sample cannot be used with schema or pgcopy", Ost, Ocon, Oenv);
+            }
 
-            // Read/Set rowset Param:
-            ParamReader params = srvInterface.getParamReader();
-            if (params.containsParameter("rowset"))
+            // Check resume Params:
+            if (params.containsParameter("resume_key"))
             {
-                vint rowset_param = params.getIntRef("rowset");
-                if (rowset_param < 1 || rowset_param > MAX_ROWSET)
+                if (!is_select || params.containsParameter("watermark") ||
+                    (params.containsParameter("pgcopy") && params.getBoolRef("pgcopy") == VTrue) ||
+                    (params.containsParameter("direct_fetch") && params.getBoolRef("direct_fetch") == VTrue))
+                { // a direct fetch keeps its diagnostics out of the statement handle the transient check reads
+                    ex_err(0, 0, 212, "DBLink. Error resume_key requires a SELECT statement, without watermark, pgcopy or direct_fetch", Ost, Ocon, Oenv);
+                }
+                if (params.containsParameter("max_retries") &&
+                    (params.getIntRef("max_retries") < 0 || params.getIntRef("max_retries") > 100))
                 {
-                    ex_err(0, 0, 203, "DBLink. Error rowset out of range", Ost, Ocon, Oenv);
+                    ex_err(0, 0, 212, "DBLink. Error max_retries out of range", Ost, Ocon, Oenv);
                 }
-                else
+            }
+
+            // Dry run: returns the binding and remote plans, nothing is requested for the result set
+            if (params.containsParameter("explain") && params.getBoolRef("explain") == VTrue)
+            {
+                if (!is_select || !strncasecmp(cid_value.c_str(), "ADBC:", 5))
                 {
-                    rowset = (size_t)rowset_param;
+                    ex_err(0, 0, 213, "DBLink. Error explain requires a SELECT statement on an ODBC connection", Ost, Ocon, Oenv);
                 }
+                outputTypes.addVarchar(16, "section");
+                outputTypes.addInt("column_id");
+                outputTypes.addVarchar(MAXCNAMELEN, "column_name");
+                outputTypes.addVarchar(MAXCNAMELEN, "remote_type");
+                outputTypes.addInt("remote_length");
+                outputTypes.addVarchar(64, "output_type");
+                outputTypes.addVarchar(32, "c_type");
+                outputTypes.addInt("bytes_per_row");
+                outputTypes.addInt("buffer_bytes");
+                outputTypes.addVarchar(MAX_CHAR_LEN, "note");
+                return;
             }
-            else
+
+            // Non ODBC backends describe the result set themselves:
+            std::unique_ptr<DBLinkBackend> backend(newBackend(cid_value, query, is_select));
+            if (backend)
             {
-                rowset = DEF_ROWSET;
+                if (params.containsParameter("watermark") || params.containsParameter("resume_key"))
+                {
+                    ex_err(0, 0, 206, "DBLink. Error watermark and resume_key are only supported on ODBC connections", Ost, Ocon, Oenv);
+                }
+                backend->describe(srvInterface, outputTypes);
+                return;
+            }
+
+            // Declared output columns skip the remote connection during planning:
+            if (is_select && params.containsParameter("schema"))
+            {
+                if (params.containsParameter("width_sample"))
+                {
+                    ex_err(0, 0, 216, "DBLink. Error width_sample cannot be used with schema or pgcopy", Ost, Ocon, Oenv);
+                }
+                alloc_size_res += parseSchema(params.getStringRef("schema").str(), outputTypes) * rowset;
+                alloc_size_res += stagingSize(workers, outputTypes.getColumnCount(), rowset);
+                checkWatermark(params, outputTypes);
+                return;
             }
 
             // ODBC Connection:
@@ -842,6 +6298,12 @@ namespace DBLINK
             {
                 ex_err(0, 0, 109, "Error allocating Connection Handle", Ost, Ocon, Oenv);
             }
+            getGovernorParams(srvInterface, gov);
+            long waited = slot.acquire(cid_value, "connection", gov.max_connections, gov.priority, gov.timeout);
+            if (waited > 0)
+            {
+                srvInterface.log("DBLinkFactory waited %ld ms in the governor queue for a connection slot", waited);
+            }
             if (!SQL_SUCCEEDED(Oret = SQLDriverConnect(Ocon, (SQLHWND)NULL, (SQLCHAR *)cid_value.c_str(), SQL_NTS, NULL, 0, NULL, SQL_DRIVER_NOPROMPT)))
             {
                 ex_err(SQL_HANDLE_DBC, Ocon, 110, "Error connecting to target database", Ost, Ocon, Oenv);
@@ -859,25 +6321,63 @@ namespace DBLINK
             {
                 ex_err(SQL_HANDLE_DBC, Ocon, 202, "Error getting remote DBMS Name", Ost, Ocon, Oenv);
             }
-            if (!strcmp((char *)Obuff, "Oracle"))
+            dbt = getDbType((char *)Obuff);
+            memset(&Obuff[0], 0, sizeof(Obuff));
+
+            // Check segment_table Param:
+            if (params.containsParameter("segment_table") && dbt != VERTICA)
+            {
+                ex_err(0, 0, 217, "DBLink. Error segment_table requires a Vertica remote database", Ost, Ocon, Oenv);
+            }
+
+            // Check pgcopy Param:
+            if (params.containsParameter("pgcopy") && params.getBoolRef("pgcopy") == VTrue)
             {
-                dbt = ORACLE;
+#ifdef DBLINK_LIBPQ
+                if (dbt != POSTGRES)
+                {
+                    ex_err(0, 0, 204, "DBLink. Error pgcopy requires a PostgreSQL remote database", Ost, Ocon, Oenv);
+                }
+#else
+                ex_err(0, 0, 204, "DBLink. Error pgcopy requires DBLINK built with WITH_LIBPQ=1", Ost, Ocon, Oenv);
+#endif
             }
-            else
+
+            // Declare the observed widths of the string columns, sampled once per CID and query:
+            std::map<size_t, SQLULEN> widths;
+            if (is_select && params.containsParameter("width_sample") && params.getIntRef("width_sample") > 0)
             {
-                dbt = GENERIC;
+                std::string file = widthCacheFile(srvInterface, replicas, cid_value, query);
+                if (!loadWidths(file, widths) && sampleWidths(srvInterface, Ocon, query, params.getIntRef("width_sample"), widths))
+                {
+                    saveWidths(file, widths);
+                }
             }
-            memset(&Obuff[0], 0, sizeof(Obuff));
 
             if (is_select)
             {
-                if (!SQL_SUCCEEDED(Oret = SQLPrepare(Ost, (SQLCHAR *)query.c_str(), SQL_NTS)))
+                // Describe a zero rows probe where describing the query would run it:
+                std::string describeQuery = getDescribeQuery(dbt, query);
+                if (describeQuery != query)
                 {
-                    ex_err(SQL_HANDLE_STMT, Ost, 112, "Error preparing the statement", Ost, Ocon, Oenv);
+                    described = SQL_SUCCEEDED(Oret = SQLPrepare(Ost, (SQLCHAR *)describeQuery.c_str(), SQL_NTS)) &&
+                                SQL_SUCCEEDED(Oret = SQLNumResultCols(Ost, (SQLSMALLINT *)&Oncol));
+                    if (!described)
+                    { // e.g. ORDER BY is not allowed in derived tables
+                        srvInterface.log("DBLinkFactory unable to describe the query through a zero rows probe. Describing the query itself");
+                        (void)SQLFreeStmt(Ost, SQL_CLOSE);
+                    }
                 }
-                if (!SQL_SUCCEEDED(Oret = SQLNumResultCols(Ost, (SQLSMALLINT *)&Oncol)))
+                if (!described)
                 {
-                    ex_err(SQL_HANDLE_STMT, Ost, 115, "Error finding the number of resulting columns", Ost, Ocon, Oenv);
+                    if (!SQL_SUCCEEDED(Oret = SQLPrepare(Ost, (SQLCHAR *)query.c_str(), SQL_NTS)))
+                    {
+                        ex_err(SQL_HANDLE_STMT, Ost, 112, "Error preparing the statement", Ost, Ocon, Oenv);
+                    }
+                    if (!SQL_SUCCEEDED(Oret = SQLNumResultCols(Ost, (SQLSMALLINT *)&Oncol)))
+                    {
+                        ex_err(SQL_HANDLE_STMT, Ost, 115, "Error finding the number of resulting columns", Ost, Ocon, Oenv);
+                    }
                 }
 
                 std::unique_ptr<SQLSMALLINT[], decltype(&free)> Odt(static_cast<SQLSMALLINT *>(calloc((size_t)Oncol, sizeof(SQLSMALLINT))), std::free);
@@ -904,9 +6404,14 @@ namespace DBLINK
                     ex_err(0, 0, 119, "Error allocating result set decimal size array", Ost, Ocon, Oenv);
                 }
 
+                // Size the rowset buffers as DBLink::prepare binds them. Parquet extraction returns the files written instead:
+                bool parquet = params.containsParameter("parquet_path");
+                size_t row_bytes = 0;
                 for (unsigned int j = 0; j < Oncol; j++)
                 {
                     SQLLEN Ool = 0;
+                    SQLULEN width = 0;
+                    ColumnPlan plan;
                     if (!SQL_SUCCEEDED(Oret = SQLDescribeCol(Ost, (SQLUSMALLINT)(j + 1),
                                                              Ocname, (SQLSMALLINT)MAXCNAMELEN, &Onamel,
                                                              &Odt[j], &Ors[j], &Odd[j], &Onull)))
@@ -916,83 +6421,8 @@ namespace DBLINK
 #ifdef DBLINK_DEBUG
                     srvInterface.log("DEBUG DBLinkFactory SQLDescribeCol src column=%u name=%s data_type=%d length=%zu", j, (char *)Ocname, Odt[j], Ors[j]);
 #endif
-
-                    alloc_size_res += sizeof(SQLLEN) * rowset;
-                    std::string cname((char *)Ocname);
-                    switch (Odt[j])
+                    if (isStringType(Odt[j]))
                     {
-                    case SQL_SMALLINT:
-                    case SQL_INTEGER:
-                    case SQL_TINYINT:
-                    case SQL_BIGINT:
-                        alloc_size_res += (dbt == ORACLE ? (size_t)(Ors[j] + 1) : sizeof(vint)) * rowset;
-                        outputTypes.addInt(cname);
-                        break;
-                    case SQL_REAL:
-                    case SQL_DOUBLE:
-                    case SQL_FLOAT:
-                        alloc_size_res += sizeof(vfloat) * rowset;
-                        outputTypes.addFloat(cname);
-                        break;
-                    case SQL_NUMERIC:
-                    case SQL_DECIMAL:
-                        alloc_size_res += MAX_NUMERIC_CHARLEN * rowset;
-                        outputTypes.addNumeric((int32)Ors[j], (int32)Odd[j], cname);
-                        break;
-                    case SQL_CHAR:
-                    case SQL_WCHAR:
-                        if (!SQL_SUCCEEDED(Oret = SQLColAttribute(Ost, (SQLUSMALLINT)(j + 1), SQL_DESC_OCTET_LENGTH,
-                                                                  (SQLPOINTER)NULL, (SQLSMALLINT)0, (SQLSMALLINT *)NULL, &Ool)))
-                        {
-                            ex_err(SQL_HANDLE_STMT, Ost, 120, "Error getting column description", Ost, Ocon, Oenv);
-                        }
-#ifdef DBLINK_DEBUG
-                        srvInterface.log("DEBUG DBLinkFactory SQLColAttribute SQL_DESC_OCTET_LENGTH src column=%u name=%s data_type=%d length=%ld", j, (char *)Ocname, Odt[j], Ool);
-#endif
-                        if (Ool > 0 && (SQLULEN)Ool > Ors[j])
-                        {
-                            Ors[j] = Ool;
-                        }
-                        if (Ors[j] > MAX_CHAR_LEN)
-                        {
-                            srvInterface.log("DBLinkFactory SQL_[W]CHAR column %s of length %zu limited to %d bytes", (char *)Ocname, Ors[j], MAX_CHAR_LEN);
-                            Ors[j] = MAX_CHAR_LEN;
-                        }
-                        if (!Ors[j])
-                        {
-                            Ors[j] = 1;
-                        }
-                        alloc_size_res += (size_t)(Ors[j] + 1) * rowset;
-                        outputTypes.addChar((int32)Ors[j], cname);
-                        break;
-                    case SQL_VARCHAR:
-                    case SQL_WVARCHAR:
-                        if (!SQL_SUCCEEDED(Oret = SQLColAttribute(Ost, (SQLUSMALLINT)(j + 1), SQL_DESC_OCTET_LENGTH,
-                                                                  (SQLPOINTER)NULL, (SQLSMALLINT)0, (SQLSMALLINT *)NULL, &Ool)))
-                        {
-                            ex_err(SQL_HANDLE_STMT, Ost, 120, "Error getting column description", Ost, Ocon, Oenv);
-                        }
-#ifdef DBLINK_DEBUG
-                        srvInterface.log("DEBUG DBLinkFactory SQLColAttribute SQL_DESC_OCTET_LENGTH src column=%u name=%s data_type=%d length=%ld", j, (char *)Ocname, Odt[j], Ool);
-#endif
-                        if (Ool > 0 && (SQLULEN)Ool > Ors[j])
-                        {
-                            Ors[j] = Ool;
-                        }
-                        if (Ors[j] > MAX_CHAR_LEN)
-                        {
-                            srvInterface.log("DBLinkFactory SQL_[W]VARCHAR column %s of length %zu limited to %d bytes", (char *)Ocname, Ors[j], MAX_CHAR_LEN);
-                            Ors[j] = MAX_CHAR_LEN;
-                        }
-                        if (!Ors[j])
-                        {
-                            Ors[j] = 1;
-                        }
-                        alloc_size_res += (size_t)(Ors[j] + 1) * rowset;
-                        outputTypes.addVarchar((int32)Ors[j], cname);
-                        break;
-                    case SQL_LONGVARCHAR:
-                    case SQL_WLONGVARCHAR:
                         if (!SQL_SUCCEEDED(Oret = SQLColAttribute(Ost, (SQLUSMALLINT)(j + 1), SQL_DESC_OCTET_LENGTH,
                                                                   (SQLPOINTER)NULL, (SQLSMALLINT)0, (SQLSMALLINT *)NULL, &Ool)))
                         {
@@ -1001,68 +6431,42 @@ namespace DBLINK
 #ifdef DBLINK_DEBUG
                         srvInterface.log("DEBUG DBLinkFactory SQLColAttribute SQL_DESC_OCTET_LENGTH src column=%u name=%s data_type=%d length=%ld", j, (char *)Ocname, Odt[j], Ool);
 #endif
-                        if (Ool > 0 && (SQLULEN)Ool > Ors[j])
-                        {
-                            Ors[j] = Ool;
-                        }
-                        if (Ors[j] > MAX_LONGCHAR_LEN)
-                        {
-                            srvInterface.log("DBLinkFactory SQL_LONG[W]VARCHAR column %s of length %zu limited to %d bytes", (char *)Ocname, Ors[j], MAX_LONGCHAR_LEN);
-                            Ors[j] = MAX_LONGCHAR_LEN;
-                        }
-                        if (!Ors[j])
-                        {
-                            Ors[j] = 1;
-                        }
-                        alloc_size_res += (size_t)(Ors[j] + 1) * rowset;
-                        outputTypes.addLongVarchar((int32)Ors[j], cname);
-                        break;
-                    case SQL_TYPE_TIME:
-                        alloc_size_res += sizeof(SQL_TIME_STRUCT) * rowset;
-                        outputTypes.addTime((int32)Odd[j], cname);
-                        break;
-                    case SQL_TYPE_DATE:
-                        alloc_size_res += sizeof(SQL_DATE_STRUCT) * rowset;
-                        outputTypes.addDate(cname);
-                        break;
-                    case SQL_TYPE_TIMESTAMP:
-                        alloc_size_res += sizeof(SQL_TIMESTAMP_STRUCT) * rowset;
-                        outputTypes.addTimestamp((int32)Odd[j], cname);
-                        break;
-                    case SQL_BIT:
-                        alloc_size_res += rowset;
-                        outputTypes.addBool(cname);
-                        break;
-                    case SQL_BINARY:
-                    case SQL_VARBINARY:
-                        if (Ors[j] > MAX_BINARY_LEN)
-                        {
-                            srvInterface.log("DBLinkFactory SQL_[VAR]BINARY column %s of length %zu limited to %d bytes", (char *)Ocname, Ors[j], MAX_BINARY_LEN);
-                            Ors[j] = MAX_BINARY_LEN;
-                        }
-                        alloc_size_res += (size_t)(Ors[j] + 1) * rowset;
-                        outputTypes.addBinary((int32)Ors[j], cname);
-                        break;
-                    case SQL_LONGVARBINARY:
-                        if (Ors[j] > MAX_LONGBINARY_LEN)
-                        {
-                            srvInterface.log("DBLinkFactory SQL_LONGVARBINARY column %s of length %zu limited to %d bytes", (char *)Ocname, Ors[j], MAX_LONGBINARY_LEN);
-                            Ors[j] = MAX_LONGBINARY_LEN;
-                        }
-                        alloc_size_res += (size_t)(Ors[j] + 1) * rowset;
-                        outputTypes.addLongVarbinary((int32)Ors[j], cname);
-                        break;
-                    case SQL_INTERVAL_YEAR_TO_MONTH:
-                        alloc_size_res += sizeof(SQL_INTERVAL_STRUCT) * rowset;
-                        outputTypes.addIntervalYM(INTERVAL_YEAR2MONTH, cname);
-                        break;
-                    case SQL_INTERVAL_DAY_TO_SECOND:
-                        alloc_size_res += sizeof(SQL_INTERVAL_STRUCT) * rowset;
-                        outputTypes.addInterval((int32)Odd[j], INTERVAL_DAY2SECOND, cname);
-                        break;
-                    default:
+                        auto it = widths.find(j);
+                        width = (it != widths.end()) ? it->second : 0;
+                    }
+                    if (!planColumn(dbt, Odt[j], Ors[j], Ool, Odd[j], width, plan))
+                    {
                         vt_report_error(121, "DBLinkFactory. Unsupported data type for column %u", j);
                     }
+                    if (plan.length && !plan.note.empty())
+                    {
+                        srvInterface.log("DBLinkFactory column %s: %s", (char *)Ocname, plan.note.c_str());
+                    }
+                    row_bytes += plan.desz + sizeof(SQLLEN);
+                    if (!parquet)
+                    {
+                        addOutputType(outputTypes, Odt[j], Ors[j], Odd[j], plan, std::string((char *)Ocname));
+                    }
+                }
+                alloc_size_res += row_bytes * rowset;
+
+                // segment_table reads through one stream per remote node, and hedge through a stream on the next replica,
+                // each with its own rowset buffers:
+                if (params.containsParameter("segment_table"))
+                {
+                    alloc_size_res += row_bytes * rowset * upNodes(Ocon);
+                }
+                if (params.containsParameter("hedge") && params.getIntRef("hedge") > 0)
+                {
+                    alloc_size_res += row_bytes * rowset;
+                }
+                if (parquet)
+                { // the row group and pages buffered by ParquetWriter, in place of the staged values
+                    alloc_size_res += parquetMemory((size_t)Oncol, (workers > 1) ? std::min(workers, (size_t)Oncol) : 1);
+                    clean(Ost, Ocon, Oenv);
+                    outputTypes.addVarchar(MAX_PARQUET_PATH, "file");
+                    outputTypes.addInt("rows");
+                    return;
                 }
             }
             else
@@ -1070,10 +6474,326 @@ namespace DBLINK
                 outputTypes.addInt("dblink");
             }
 
+            // Park the statement for the DBLink instance instead of closing it. Not when a zero rows probe
+            // was described, or when the instance runs the query wrapped (watermark, resume_key) or over libpq:
+            std::string handoff = params.containsParameter("handoff") ? params.getStringRef("handoff").str() : "none";
+            if (is_select && !described && strcasecmp(handoff.c_str(), "none") &&
+                !params.containsParameter("watermark") && !params.containsParameter("resume_key") && !params.containsParameter("filter_key") &&
+                !params.containsParameter("segment_table") &&
+                !(params.containsParameter("pgcopy") && params.getBoolRef("pgcopy") == VTrue))
+            {
+                parkHandoff(cid_value, replicas, query, dbt, slot, Ost, Ocon, Oenv);
+            }
 #ifdef DBLINK_DEBUG
             srvInterface.log("DEBUG DBLinkFactory clean called in DBLinkFactory::getReturnType");
 #endif
             clean(Ost, Ocon, Oenv);
+            if (is_select)
+            {
+                alloc_size_res += stagingSize(workers, outputTypes.getColumnCount(), rowset);
+            }
+            checkWatermark(params, outputTypes);
+        }
+
+        // Number of UP nodes of the remote Vertica, 1 if it cannot be read
+        size_t upNodes(SQLHDBC Ocon)
+        {
+            SQLHSTMT Osst = nullptr;
+            SQLBIGINT Ocount = 1;
+            SQLLEN Oind = 0;
+
+            if (!SQL_SUCCEEDED(SQLAllocHandle(SQL_HANDLE_STMT, Ocon, &Osst)))
+            {
+                return 1;
+            }
+            if (!SQL_SUCCEEDED(SQLExecDirect(Osst, (SQLCHAR *)"SELECT COUNT(*) FROM v_catalog.nodes WHERE node_state = 'UP'", SQL_NTS)) ||
+                !SQL_SUCCEEDED(SQLFetch(Osst)) || !SQL_SUCCEEDED(SQLGetData(Osst, 1, SQL_C_SBIGINT, &Ocount, 0, &Oind)) || Oind == SQL_NULL_DATA)
+            {
+                Ocount = 1;
+            }
+            (void)SQLFreeHandle(SQL_HANDLE_STMT, Osst);
+            return (size_t)std::max(Ocount, (SQLBIGINT)1);
+        }
+
+        // Samples the first rows of the query for the widths of its string columns: NARROW_FACTOR times the longest
+        // value. Columns whose value lengths the driver does not report keep their remote width
+        bool sampleWidths(ServerInterface &srvInterface, SQLHDBC Ocon, const std::string &query, vint sample, std::map<size_t, SQLULEN> &widths)
+        {
+            SQLHSTMT Osst = nullptr;
+            SQLRETURN Oret = 0;
+            SQLSMALLINT Oncol = 0;
+            SQLCHAR Obuff[1]; // SQLGetData only reports the lengths
+            std::vector<SQLLEN> longest;
+
+            if (!SQL_SUCCEEDED(Oret = SQLAllocHandle(SQL_HANDLE_STMT, Ocon, &Osst)))
+            {
+                return false;
+            }
+            (void)SQLSetStmtAttr(Osst, SQL_ATTR_MAX_ROWS, (SQLPOINTER)(SQLULEN)sample, 0);
+            if (!SQL_SUCCEEDED(Oret = SQLExecDirect(Osst, (SQLCHAR *)query.c_str(), SQL_NTS)) ||
+                !SQL_SUCCEEDED(Oret = SQLNumResultCols(Osst, &Oncol)))
+            {
+                srvInterface.log("DBLinkFactory unable to sample the query, string columns keep their remote width");
+                (void)SQLFreeHandle(SQL_HANDLE_STMT, Osst);
+                return false;
+            }
+            longest.assign((size_t)Oncol, -1);
+            for (SQLSMALLINT j = 0; j < Oncol; j++)
+            {
+                SQLLEN Ocdt = 0;
+                (void)SQLColAttribute(Osst, (SQLUSMALLINT)(j + 1), SQL_DESC_CONCISE_TYPE, (SQLPOINTER)NULL, (SQLSMALLINT)0, (SQLSMALLINT *)NULL, &Ocdt);
+                if (Ocdt == SQL_CHAR || Ocdt == SQL_WCHAR || Ocdt == SQL_VARCHAR || Ocdt == SQL_WVARCHAR ||
+                    Ocdt == SQL_LONGVARCHAR || Ocdt == SQL_WLONGVARCHAR)
+                {
+                    longest[j] = 0;
+                }
+            }
+            for (vint rows = 0; rows < sample && SQL_SUCCEEDED(Oret = SQLFetch(Osst)); rows++)
+            {
+                for (SQLSMALLINT j = 0; j < Oncol; j++)
+                {
+                    SQLLEN Oind = 0;
+                    if (longest[j] < 0)
+                    {
+                        continue;
+                    }
+                    if (!SQL_SUCCEEDED(Oret = SQLGetData(Osst, (SQLUSMALLINT)(j + 1), SQL_C_CHAR, Obuff, (SQLLEN)sizeof(Obuff), &Oind)) ||
+                        Oind == SQL_NO_TOTAL)
+                    {
+                        longest[j] = -1;
+                    }
+                    else if (Oind != SQL_NULL_DATA)
+                    {
+                        longest[j] = std::max(longest[j], Oind);
+                    }
+                }
+            }
+            (void)SQLCancel(Osst);
+            (void)SQLFreeHandle(SQL_HANDLE_STMT, Osst);
+            for (size_t j = 0; j < longest.size(); j++)
+            {
+                if (longest[j] >= 0)
+                {
+                    widths[j] = (SQLULEN)std::max((SQLLEN)NARROW_MIN_WIDTH, longest[j] * NARROW_FACTOR);
+                }
+            }
+            return true;
+        }
+
+        // Declares the output column of a result set column planned by planColumn
+        void addOutputType(SizedColumnTypes &outputTypes, SQLSMALLINT Odt, SQLULEN Ors, SQLSMALLINT Odd, const ColumnPlan &plan, const std::string &cname)
+        {
+            switch (Odt)
+            {
+            case SQL_SMALLINT:
+            case SQL_INTEGER:
+            case SQL_TINYINT:
+            case SQL_BIGINT:
+                outputTypes.addInt(cname);
+                break;
+            case SQL_REAL:
+            case SQL_DOUBLE:
+            case SQL_FLOAT:
+                outputTypes.addFloat(cname);
+                break;
+            case SQL_NUMERIC:
+            case SQL_DECIMAL:
+                outputTypes.addNumeric((int32)Ors, (int32)Odd, cname);
+                break;
+            case SQL_CHAR:
+            case SQL_WCHAR:
+                outputTypes.addChar((int32)plan.length, cname);
+                break;
+            case SQL_VARCHAR:
+            case SQL_WVARCHAR:
+                outputTypes.addVarchar((int32)plan.length, cname);
+                break;
+            case SQL_LONGVARCHAR:
+            case SQL_WLONGVARCHAR:
+                outputTypes.addLongVarchar((int32)plan.length, cname);
+                break;
+            case SQL_TYPE_TIME:
+                outputTypes.addTime((int32)Odd, cname);
+                break;
+            case SQL_TYPE_DATE:
+                outputTypes.addDate(cname);
+                break;
+            case SQL_TYPE_TIMESTAMP:
+                outputTypes.addTimestamp((int32)Odd, cname);
+                break;
+            case SQL_BIT:
+                outputTypes.addBool(cname);
+                break;
+            case SQL_BINARY:
+            case SQL_VARBINARY:
+                outputTypes.addBinary((int32)plan.length, cname);
+                break;
+            case SQL_LONGVARBINARY:
+                outputTypes.addLongVarbinary((int32)plan.length, cname);
+                break;
+            case SQL_INTERVAL_YEAR_TO_MONTH:
+                outputTypes.addIntervalYM(INTERVAL_YEAR2MONTH, cname);
+                break;
+            case SQL_INTERVAL_DAY_TO_SECOND:
+                outputTypes.addInterval((int32)Odd, INTERVAL_DAY2SECOND, cname);
+                break;
+            }
+        }
+
+        // Hands the connection and prepared statement over to the HandoffRegistry. The handles are left null for clean()
+        void parkHandoff(const std::string &cid_value, const std::vector<std::string> &replicas, const std::string &query, DBs dbt,
+                         GovernorSlot &slot, SQLHSTMT &Ost, SQLHDBC &Ocon, SQLHENV &Oenv)
+        {
+            std::unique_ptr<Handoff> h(new Handoff());
+
+            std::swap(h->Oenv, Oenv);
+            std::swap(h->Ocon, Ocon);
+            std::swap(h->Ost, Ost);
+            h->conn_slot.take(slot);
+            h->dbt = dbt;
+            h->member = cid_value;
+            HandoffRegistry::instance().park(HandoffRegistry::key(replicas, cid_value, query), std::move(h));
+        }
+
+        // Staged values of the conversion workers, see DBLink::prepare
+        size_t stagingSize(size_t workers, size_t ncol, size_t rowset)
+        {
+            return (workers > 1 && ncol > 1) ? sizeof(StagedValue) * ncol * rowset : 0;
+        }
+
+        void checkBulk(ServerInterface &srvInterface, ParamReader &params, const std::string &cid_value, const SizedColumnTypes &inputTypes, size_t rowset)
+        {
+            if (params.containsParameter("query") || params.containsParameter("schema") || params.containsParameter("watermark") ||
+                params.containsParameter("explain") || params.containsParameter("parquet_path"))
+            {
+                vt_report_error(210, "DBLinkFactory. Error target cannot be used with query, schema, watermark, explain or parquet_path");
+            }
+            if (!strncasecmp(cid_value.c_str(), "ADBC:", 5))
+            {
+                vt_report_error(210, "DBLinkFactory. Error target requires an ODBC connection");
+            }
+            if (inputTypes.getColumnCount() == 0)
+            {
+                vt_report_error(210, "DBLinkFactory. Error target requires input columns");
+            }
+            if (params.containsParameter("commit_size") && params.getIntRef("commit_size") < 0)
+            {
+                vt_report_error(210, "DBLinkFactory. Error commit_size out of range");
+            }
+            if (params.containsParameter("pgcopy") && params.getBoolRef("pgcopy") == VTrue)
+            {
+#ifdef DBLINK_LIBPQ
+                checkPgTarget(srvInterface, cid_value);
+#else
+                vt_report_error(204, "DBLinkFactory. Error pgcopy requires DBLINK built with WITH_LIBPQ=1");
+#endif
+            }
+
+            // Parameter arrays of the INSERT fallback:
+            for (size_t j = 0; j < inputTypes.getColumnCount(); j++)
+            {
+                SQLSMALLINT Oct = 0;
+                SQLSMALLINT Opt = 0;
+                SQLULEN Ocs = 0;
+                SQLSMALLINT Odd = 0;
+                size_t desz = 0;
+                if (!getBulkParam(inputTypes.getColumnType(j), Oct, Opt, Ocs, Odd, desz))
+                {
+                    vt_report_error(210, "DBLinkFactory. Unsupported data type for input column %zu", j);
+                }
+                alloc_size_res += (desz + sizeof(SQLLEN)) * rowset;
+            }
+            alloc_size_res += sizeof(SQLUSMALLINT) * rowset;
+        }
+
+#ifdef DBLINK_LIBPQ
+        // Connects to the target of a pgcopy bulk export, which must be PostgreSQL
+        void checkPgTarget(ServerInterface &srvInterface, const std::string &cid_value)
+        {
+            SQLHENV Oenv = nullptr;
+            SQLHDBC Ocon = nullptr;
+            SQLHSTMT Ost = nullptr;
+            SQLCHAR Obuff[64];
+            GovernorParams gov;
+            GovernorSlot slot;
+
+            if (!SQL_SUCCEEDED(SQLAllocHandle(SQL_HANDLE_ENV, (SQLHANDLE)SQL_NULL_HANDLE, &Oenv)))
+            {
+                ex_err(0, 0, 107, "Error allocating Environment Handle", Ost, Ocon, Oenv);
+            }
+            if (!SQL_SUCCEEDED(SQLSetEnvAttr(Oenv, SQL_ATTR_ODBC_VERSION, (void *)SQL_OV_ODBC3, 0)))
+            {
+                ex_err(0, 0, 108, "Error setting SQL_OV_ODBC3", Ost, Ocon, Oenv);
+            }
+            if (!SQL_SUCCEEDED(SQLAllocHandle(SQL_HANDLE_DBC, Oenv, &Ocon)))
+            {
+                ex_err(0, 0, 109, "Error allocating Connection Handle", Ost, Ocon, Oenv);
+            }
+            getGovernorParams(srvInterface, gov);
+            (void)slot.acquire(cid_value, "connection", gov.max_connections, gov.priority, gov.timeout);
+            if (!SQL_SUCCEEDED(SQLDriverConnect(Ocon, (SQLHWND)NULL, (SQLCHAR *)cid_value.c_str(), SQL_NTS, NULL, 0, NULL, SQL_DRIVER_NOPROMPT)))
+            {
+                ex_err(SQL_HANDLE_DBC, Ocon, 110, "Error connecting to target database", Ost, Ocon, Oenv);
+            }
+            if (!SQL_SUCCEEDED(SQLGetInfo(Ocon, SQL_DBMS_NAME, (SQLPOINTER)Obuff, (SQLSMALLINT)sizeof(Obuff), NULL)))
+            {
+                ex_err(SQL_HANDLE_DBC, Ocon, 202, "Error getting remote DBMS Name", Ost, Ocon, Oenv);
+            }
+            if (getDbType((char *)Obuff) != POSTGRES)
+            {
+                ex_err(0, 0, 204, "DBLink. Error pgcopy requires a PostgreSQL target database", Ost, Ocon, Oenv);
+            }
+            clean(Ost, Ocon, Oenv);
+        }
+#endif
+
+        // Semi-join pushdown: the single input column holds the keys of the IN-lists
+        void checkFilter(ParamReader &params, const std::string &cid_value, const SizedColumnTypes &inputTypes, bool is_select)
+        {
+            SQLSMALLINT Oct = 0;
+            SQLSMALLINT Opt = 0;
+            SQLULEN Ocs = 0;
+            SQLSMALLINT Odd = 0;
+            size_t keysz = 0;
+
+            if (!is_select || !strncasecmp(cid_value.c_str(), "ADBC:", 5) || params.containsParameter("watermark") ||
+                params.containsParameter("resume_key") || params.containsParameter("explain") ||
+                (params.containsParameter("pgcopy") && params.getBoolRef("pgcopy") == VTrue))
+            {
+                vt_report_error(215, "DBLinkFactory. Error filter_key requires a SELECT statement on an ODBC connection, without watermark, resume_key, explain or pgcopy");
+            }
+            if (inputTypes.getColumnCount() != 1)
+            {
+                vt_report_error(215, "DBLinkFactory. Error filter_key requires one input column (the keys)");
+            }
+            if (!getBulkParam(inputTypes.getColumnType(0), Oct, Opt, Ocs, Odd, keysz))
+            {
+                vt_report_error(215, "DBLinkFactory. Unsupported data type for the filter keys");
+            }
+            alloc_size_res += (keysz + sizeof(SQLLEN)) * FILTER_KEYS;
+        }
+
+        // Checks the watermark, resume_key and filter_key columns are in the result set
+        void checkWatermark(ParamReader &params, const SizedColumnTypes &outputTypes)
+        {
+            static const char *keys[][2] = {{"watermark", "Watermark"}, {"resume_key", "Resume key"}, {"filter_key", "Filter key"}};
+            for (auto &k : keys)
+            {
+                if (!params.containsParameter(k[0]))
+                {
+                    continue;
+                }
+                std::string column = params.getStringRef(k[0]).str();
+                bool found = false;
+                for (size_t j = 0; j < outputTypes.getColumnCount() && !found; j++)
+                {
+                    found = !strcasecmp(outputTypes.getColumnName(j).c_str(), column.c_str());
+                }
+                if (!found)
+                {
+                    vt_report_error(206, "DBLinkFactory. %s column %s not found in the result set", k[1], column.c_str());
+                }
+            }
         }
 
         void getParameterType(ServerInterface &srvInterface, SizedColumnTypes &parameterTypes)
@@ -1084,6 +6804,32 @@ namespace DBLINK
             parameterTypes.addVarchar(1024, "cidfile", {true, false, false, "Connection Identifier File Path."});
             parameterTypes.addVarchar(65000, "query", {true, false, false, "The query being pushed on the remote database. Or, '@' followed by the name of the file containing the query."});
             parameterTypes.addInt("rowset", {true, false, false, "Number of rows retrieved from the remote database during each SQLFetch() cycle. Default is 100."});
+            parameterTypes.addVarchar(65000, "schema", {true, false, false, "Output columns of the SELECT (\"name TYPE, ...\"). Skips the remote connection during planning."});
+            parameterTypes.addVarchar(1024, "watermark", {true, false, false, "Column of the SELECT (timestamp or monotonic id) used for incremental extraction."});
+            parameterTypes.addVarchar(1024, "watermark_file", {true, false, false, "File keeping the last high-water mark of the incremental extraction."});
+            parameterTypes.addInt("max_connections", {true, false, false, "Max sessions opened on the CID by all the DBLINK calls of a node. Default is unlimited."});
+            parameterTypes.addInt("max_queries", {true, false, false, "Max queries running on the CID for all the DBLINK calls of a node. Default is unlimited."});
+            parameterTypes.addInt("priority", {true, false, false, "Priority (0-999) in the max_connections/max_queries queue. Default is 50."});
+            parameterTypes.addInt("queue_timeout", {true, false, false, "Seconds to wait for a max_connections/max_queries slot. Default is 600."});
+            parameterTypes.addBool("pgcopy", {true, false, false, "Fetch SELECT results from (or push target rows to) PostgreSQL through libpq COPY BINARY instead of ODBC. Default is false."});
+            parameterTypes.addVarchar(1024, "resume_key", {true, false, false, "Unique, not null column of the SELECT. Orders the extraction by it to resume after transient failures."});
+            parameterTypes.addVarchar(1024, "checkpoint_file", {true, false, false, "File where the last emitted resume_key value and row count are saved during the extraction."});
+            parameterTypes.addInt("max_retries", {true, false, false, "Reconnections of a resume_key extraction after transient failures. Default is 3."});
+            parameterTypes.addInt("workers", {true, false, false, "Threads converting the columns of each fetched rowset (2-16). Default is 0 (the fetch thread converts)."});
+            parameterTypes.addVarchar(1024, "target", {true, false, false, "Remote table (optionally followed by its column list) the input columns are pushed to."});
+            parameterTypes.addInt("width_sample", {true, false, false, "Rows sampled (once per CID and query) to declare the string columns with their observed width. Default is 0 (remote width)."});
+            parameterTypes.addVarchar(MAX_PARQUET_PATH, "width_cache", {true, false, false, "Directory of the observed widths cache (width_sample), shared by the nodes if on a shared file system. Default is " DBLINK_WIDTHS_DIR "."});
+            parameterTypes.addVarchar(1024, "filter_key", {true, false, false, "Column of the SELECT restricted to the values of the input column (semi-join pushed to the remote database)."});
+            parameterTypes.addVarchar(1024, "segment_table", {true, false, false, "Remote Vertica table ([schema.]table) whose segmentation splits the query across one connection per remote node."});
+            parameterTypes.addInt("hedge", {true, false, false, "Latency percentile (1-99) of the recent queries of a replica group CID past which the query is also sent to the next replica. Default is 0 (not hedged)."});
+            parameterTypes.addBool("direct_fetch", {true, false, false, "Fetch the rowsets from the ODBC driver library, bypassing the driver manager. Default is false."});
+            parameterTypes.addVarchar(1024, "parquet_path", {true, false, false, "Directory the result set is written to as Parquet files. One row (file, rows) is returned per file."});
+            parameterTypes.addInt("parquet_file_size", {true, false, false, "Size in MB (1-65536) of the Parquet files before a new one is started. Default is 256."});
+            parameterTypes.addVarchar(16, "parquet_compression", {true, false, false, "Compression of the Parquet pages, 'gzip' or 'none'. Default is 'gzip'."});
+            parameterTypes.addVarchar(16, "handoff", {true, false, false, "Keep the statement prepared while planning ('prepare') for the instance of the same process. Default is 'none'."});
+            parameterTypes.addVarchar(1024, "trace_file", {true, false, false, "File where the connect/prepare/execute/fetch/convert spans are appended in Chrome trace-event format."});
+            parameterTypes.addBool("explain", {true, false, false, "Return the binding of each result set column, the scratch memory and the remote plan instead of running the query. Default is false."});
+            parameterTypes.addInt("commit_size", {true, false, false, "Rows per transaction when pushing to target. Default is one transaction per partition."});
         }
 
         void getPerInstanceResources(ServerInterface &srvInterface,
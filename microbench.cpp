@@ -0,0 +1,277 @@
+// Microbenchmarks of the DBLINK() conversion kernels (dblink_convert.h).
+// Builds without the Vertica SDK: "make microbench". Each kernel converts a rowset of
+// MICROBENCH_ROWSET realistic values bound as DBLINK binds them, and reports ns/value.
+
+#include "dblink_convert.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define MICROBENCH_ROWSET 1000  // Rows per rowset, as MAX_ROWSET
+#define MICROBENCH_VALUES 20000000 // Values converted per kernel
+#define MICROBENCH_NUMERIC_LEN 128 // As MAX_NUMERIC_CHARLEN
+#define MICROBENCH_WIDE_ROWSETS 200 // Rowsets converted by the wide table runs
+#define MICROBENCH_SINK_LEN 65000 // String copy buffer, as MAX_CHAR_LEN
+
+using namespace DBLINK;
+
+// Writer that folds the values into a checksum, so that the kernels are not optimized away. Numerics
+// are parsed and strings copied, as the Vertica writer does, so that their kernels are not flattered
+class FakeWriter
+{
+    char sink[MICROBENCH_SINK_LEN];
+
+public:
+    uint64_t sum = 0;
+
+    inline void setNull(size_t j)
+    {
+        sum += j;
+    }
+    inline void setInt(size_t j, int64_t v)
+    {
+        sum += (uint64_t)v;
+    }
+    inline void setFloat(size_t j, double v)
+    {
+        sum += (uint64_t)v;
+    }
+    inline bool setNumeric(size_t j, char *text, size_t len)
+    {
+        char *end = NULL;
+        long double v = strtold(text, &end);
+        sum += (uint64_t)v;
+        return end == text + len;
+    }
+    inline void setString(size_t j, const char *s, size_t len)
+    {
+        len = std::min(len, sizeof(sink));
+        memcpy(sink, s, len);
+        sum += len + (len ? (uint8_t)sink[len / 2] : 0);
+    }
+    inline void setBool(size_t j, bool v)
+    {
+        sum += v;
+    }
+    inline void setDate(size_t j, int64_t days)
+    {
+        sum += (uint64_t)days;
+    }
+    inline void setTime(size_t j, int64_t us)
+    {
+        sum += (uint64_t)us;
+    }
+    inline void setTimestamp(size_t j, int64_t us)
+    {
+        sum += (uint64_t)us;
+    }
+    inline void setInterval(size_t j, int64_t v)
+    {
+        sum += (uint64_t)v;
+    }
+};
+
+// One bound column: MICROBENCH_ROWSET elements of desz bytes and their length/indicators
+struct Column
+{
+    SQLSMALLINT Odt;
+    size_t desz;
+    std::vector<uint8_t> Ores;
+    std::vector<SQLLEN> Olen;
+
+    Column(SQLSMALLINT type, size_t size) : Odt(type), desz(size), Ores(size * MICROBENCH_ROWSET), Olen(MICROBENCH_ROWSET, 0) {}
+
+    void *at(size_t i)
+    {
+        return &Ores[desz * i];
+    }
+
+    void setText(size_t i, const std::string &text)
+    {
+        size_t len = std::min(text.size(), desz - 1);
+        memcpy(at(i), text.data(), len);
+        ((char *)at(i))[len] = '\0';
+        Olen[i] = (SQLLEN)len;
+    }
+};
+
+static void run(const char *name, Column &c, bool textInt, FakeWriter &w)
+{
+    SQLPOINTER Ores[1] = {(SQLPOINTER)c.Ores.data()};
+    SQLLEN *Olen[1] = {c.Olen.data()};
+    size_t errcol = 0;
+    size_t rowsets = MICROBENCH_VALUES / MICROBENCH_ROWSET;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < rowsets; r++)
+    {
+        for (size_t i = 0; i < MICROBENCH_ROWSET; i++)
+        {
+            if (convertRow(w, 1, &c.Odt, textInt, Ores, Olen, &c.desz, i, errcol) != CONVERT_OK)
+            {
+                fprintf(stderr, "%s: conversion error at row %zu\n", name, i);
+                return;
+            }
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    printf("%-24s %8.2f ns/value\n", name, ns / (double)(rowsets * MICROBENCH_ROWSET));
+}
+
+// Converts MICROBENCH_WIDE_ROWSETS rowsets of the given columns, serially (nthreads 0) or staged on a ConvertPool
+static void runWide(std::vector<Column *> &cols, size_t nthreads, FakeWriter &w)
+{
+    size_t ncol = cols.size();
+    std::vector<SQLSMALLINT> Odt(ncol);
+    std::vector<SQLPOINTER> Ores(ncol);
+    std::vector<SQLLEN *> Olen(ncol);
+    std::vector<size_t> desz(ncol);
+    std::vector<StagedValue> staged(ncol * MICROBENCH_ROWSET);
+    std::unique_ptr<ConvertPool> pool(nthreads ? new ConvertPool(nthreads) : nullptr);
+    size_t errcol = 0;
+
+    for (size_t j = 0; j < ncol; j++)
+    {
+        Odt[j] = cols[j]->Odt;
+        Ores[j] = (SQLPOINTER)cols[j]->Ores.data();
+        Olen[j] = cols[j]->Olen.data();
+        desz[j] = cols[j]->desz;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < MICROBENCH_WIDE_ROWSETS; r++)
+    {
+        if (!pool)
+        {
+            for (size_t i = 0; i < MICROBENCH_ROWSET; i++)
+            {
+                convertRow(w, ncol, Odt.data(), false, Ores.data(), Olen.data(), desz.data(), i, errcol);
+            }
+            continue;
+        }
+        pool->run(ncol, [&](size_t j) {
+            size_t errrow = 0;
+            stageColumn(&staged[j * MICROBENCH_ROWSET], Odt[j], false, Ores[j], Olen[j], desz[j], MICROBENCH_ROWSET, errrow);
+        });
+        for (size_t i = 0; i < MICROBENCH_ROWSET; i++)
+        {
+            for (size_t j = 0; j < ncol; j++)
+            {
+                writeStaged(w, j, staged[j * MICROBENCH_ROWSET + i]);
+            }
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(end - start).count();
+    printf("%zu columns, %-10s %8.2f ms/rowset\n", ncol, nthreads ? (std::to_string(nthreads) + " threads").c_str() : "serial", ms / MICROBENCH_WIDE_ROWSETS);
+}
+
+int main()
+{
+    FakeWriter w;
+    unsigned seed = 42;
+    auto rnd = [&seed]() { seed = seed * 1103515245u + 12345u; return (seed >> 8); };
+
+    Column bigint(SQL_BIGINT, sizeof(SQLBIGINT));
+    Column oraint(SQL_INTEGER, 23);
+    Column dbl(SQL_DOUBLE, sizeof(SQLDOUBLE));
+    Column numeric(SQL_NUMERIC, MICROBENCH_NUMERIC_LEN);
+    Column date(SQL_TYPE_DATE, sizeof(SQL_DATE_STRUCT));
+    Column ts(SQL_TYPE_TIMESTAMP, sizeof(SQL_TIMESTAMP_STRUCT));
+    Column time(SQL_TYPE_TIME, sizeof(SQL_TIME_STRUCT));
+    Column ivym(SQL_INTERVAL_YEAR_TO_MONTH, sizeof(SQL_INTERVAL_STRUCT));
+    Column ivds(SQL_INTERVAL_DAY_TO_SECOND, sizeof(SQL_INTERVAL_STRUCT));
+    Column str(SQL_VARCHAR, 257);
+    Column nulls(SQL_VARCHAR, 257);
+
+    for (size_t i = 0; i < MICROBENCH_ROWSET; i++)
+    {
+        *(SQLBIGINT *)bigint.at(i) = (SQLBIGINT)rnd() * 1000;
+        bigint.Olen[i] = sizeof(SQLBIGINT);
+        oraint.setText(i, std::to_string(rnd() % 100000000));
+        *(SQLDOUBLE *)dbl.at(i) = rnd() / 7.0;
+        dbl.Olen[i] = sizeof(SQLDOUBLE);
+        numeric.setText(i, std::to_string(rnd() % 10000000) + "." + std::to_string(rnd() % 100));
+
+        SQL_DATE_STRUCT &d = *(SQL_DATE_STRUCT *)date.at(i);
+        d.year = (SQLSMALLINT)(1970 + rnd() % 60);
+        d.month = (SQLUSMALLINT)(1 + rnd() % 12);
+        d.day = (SQLUSMALLINT)(1 + rnd() % 28);
+        date.Olen[i] = sizeof(SQL_DATE_STRUCT);
+
+        SQL_TIMESTAMP_STRUCT &t = *(SQL_TIMESTAMP_STRUCT *)ts.at(i);
+        t.year = d.year;
+        t.month = d.month;
+        t.day = d.day;
+        t.hour = (SQLUSMALLINT)(rnd() % 24);
+        t.minute = (SQLUSMALLINT)(rnd() % 60);
+        t.second = (SQLUSMALLINT)(rnd() % 60);
+        t.fraction = (SQLUINTEGER)(rnd() % 1000000) * 1000;
+        ts.Olen[i] = sizeof(SQL_TIMESTAMP_STRUCT);
+
+        SQL_TIME_STRUCT &tm = *(SQL_TIME_STRUCT *)time.at(i);
+        tm.hour = t.hour;
+        tm.minute = t.minute;
+        tm.second = t.second;
+        time.Olen[i] = sizeof(SQL_TIME_STRUCT);
+
+        SQL_INTERVAL_STRUCT &ym = *(SQL_INTERVAL_STRUCT *)ivym.at(i);
+        ym.interval_type = SQL_IS_YEAR_TO_MONTH;
+        ym.interval_sign = (SQLSMALLINT)(rnd() % 2);
+        ym.intval.year_month.year = rnd() % 100;
+        ym.intval.year_month.month = rnd() % 12;
+        ivym.Olen[i] = sizeof(SQL_INTERVAL_STRUCT);
+
+        SQL_INTERVAL_STRUCT &ds = *(SQL_INTERVAL_STRUCT *)ivds.at(i);
+        ds.interval_type = SQL_IS_DAY_TO_SECOND;
+        ds.interval_sign = (SQLSMALLINT)(rnd() % 2);
+        ds.intval.day_second.day = rnd() % 1000;
+        ds.intval.day_second.hour = rnd() % 24;
+        ds.intval.day_second.minute = rnd() % 60;
+        ds.intval.day_second.second = rnd() % 60;
+        ds.intval.day_second.fraction = rnd() % 1000000000;
+        ivds.Olen[i] = sizeof(SQL_INTERVAL_STRUCT);
+
+        str.setText(i, std::string(8 + rnd() % 120, (char)('a' + rnd() % 26)));
+        nulls.setText(i, "x");
+        if (rnd() % 2)
+        {
+            nulls.Olen[i] = SQL_NULL_DATA;
+        }
+    }
+
+    printf("DBLINK conversion kernels, %d rows per rowset\n", MICROBENCH_ROWSET);
+    run("BIGINT", bigint, false, w);
+    run("Oracle text INTEGER", oraint, true, w);
+    run("DOUBLE", dbl, false, w);
+    run("NUMERIC text", numeric, false, w);
+    run("DATE", date, false, w);
+    run("TIMESTAMP", ts, false, w);
+    run("TIME", time, false, w);
+    run("INTERVAL YEAR TO MONTH", ivym, false, w);
+    run("INTERVAL DAY TO SECOND", ivds, false, w);
+    run("VARCHAR", str, false, w);
+    run("VARCHAR 50% NULL", nulls, false, w);
+
+    // Wide fact table: 300 columns cycling through the kernels above
+    std::vector<Column *> kinds = {&bigint, &dbl, &numeric, &date, &ts, &time, &ivds, &str, &nulls};
+    std::vector<Column *> wide;
+    for (size_t j = 0; j < 300; j++)
+    {
+        wide.push_back(kinds[j % kinds.size()]);
+    }
+    runWide(wide, 0, w);
+    for (size_t nthreads : {2, 4, 8})
+    {
+        runWide(wide, nthreads, w);
+    }
+    printf("checksum %llu\n", (unsigned long long)w.sum);
+    return 0;
+}